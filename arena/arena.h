@@ -0,0 +1,138 @@
+#pragma once
+
+#include "../unique/unique.h"
+#include "../weak/shared.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>  // size_t, std::max_align_t
+#include <cstdint>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Bump allocator for a group of objects that die together, e.g. everything built for one request.
+// Memory is handed out from large chunks and returned all at once when the arena is destroyed.
+// Not thread-safe; must outlive every pointer created in it.
+class Arena {
+public:
+    static constexpr size_t kDefaultChunkSize = size_t{1} << 16;
+
+    explicit Arena(size_t chunk_size = kDefaultChunkSize) : chunk_size_(chunk_size) {
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        while (chunks_) {
+            ::operator delete(std::exchange(chunks_, chunks_->next));
+        }
+    }
+
+    void* Allocate(size_t size, size_t alignment) {
+        assert(alignment != 0 && (alignment & (alignment - 1)) == 0);
+        uintptr_t address = AlignUp(reinterpret_cast<uintptr_t>(current_), alignment);
+        if (!current_ || address + size > reinterpret_cast<uintptr_t>(end_)) {
+            NewChunk(size + alignment);
+            address = AlignUp(reinterpret_cast<uintptr_t>(current_), alignment);
+        }
+        current_ = reinterpret_cast<char*>(address + size);
+        return reinterpret_cast<void*>(address);
+    }
+
+    // Memory taken from the system so far.
+    size_t BytesReserved() const {
+        return bytes_reserved_;
+    }
+
+private:
+    struct alignas(std::max_align_t) Chunk {
+        Chunk* next;
+    };
+
+    static uintptr_t AlignUp(uintptr_t address, size_t alignment) {
+        return (address + alignment - 1) & ~(alignment - 1);
+    }
+
+    void NewChunk(size_t min_size) {
+        size_t size = sizeof(Chunk) + std::max(chunk_size_, min_size);
+        auto* chunk = new (::operator new(size)) Chunk{chunks_};
+        chunks_ = chunk;
+        current_ = reinterpret_cast<char*>(chunk + 1);
+        end_ = reinterpret_cast<char*>(chunk) + size;
+        bytes_reserved_ += size;
+    }
+
+    size_t chunk_size_;
+    size_t bytes_reserved_ = 0;
+    char* current_ = nullptr;
+    char* end_ = nullptr;
+    Chunk* chunks_ = nullptr;
+};
+
+// Allocator over an `Arena`: `deallocate` is a no-op, the memory goes away with the arena.
+template <typename T>
+class ArenaAllocator {
+public:
+    using value_type = T;
+
+    template <typename U>
+    friend class ArenaAllocator;
+
+    explicit ArenaAllocator(Arena& arena) noexcept : arena_(&arena) {
+    }
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena_(other.arena_) {
+    }
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena_->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) noexcept {
+    }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept {
+        return arena_ == other.arena_;
+    }
+
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept {
+        return arena_ != other.arena_;
+    }
+
+private:
+    Arena* arena_;
+};
+
+// Deleter of `MakeUniqueIn`: runs the destructor (if there is one to run) and leaves the memory to
+// the arena. Empty, so the `UniquePtr` stays one word.
+template <typename T>
+struct ArenaDelete {
+    void operator()(T* ptr) const {
+        if constexpr (!std::is_trivially_destructible_v<T>) {
+            ptr->~T();
+        }
+    }
+};
+
+template <typename T>
+using ArenaUniquePtr = UniquePtr<T, ArenaDelete<T>>;
+
+static_assert(sizeof(ArenaUniquePtr<int>) == sizeof(int*));
+
+template <typename T, typename... Args>
+ArenaUniquePtr<T> MakeUniqueIn(Arena& arena, Args&&... args) {
+    void* memory = arena.Allocate(sizeof(T), alignof(T));
+    return ArenaUniquePtr<T>(new (memory) T(std::forward<Args>(args)...));
+}
+
+// `MakeShared` with the object and its control block in `arena`. The last reference runs the
+// destructor; the block memory is not freed individually.
+template <typename T, typename... Args>
+SharedPtr<T> MakeSharedIn(Arena& arena, Args&&... args) {
+    return AllocateShared<T>(ArenaAllocator<T>(arena), std::forward<Args>(args)...);
+}
@@ -0,0 +1,57 @@
+// Readers load the current snapshot in a loop while thread 0 also publishes a new one every
+// `kWritePeriod` iterations: `AtomicSharedPtr` against a `SharedPtr` behind a mutex.
+
+#include <benchmark/benchmark.h>
+
+#include "weak/atomic_shared.h"
+
+#include <mutex>
+#include <vector>
+
+namespace {
+
+constexpr int kWritePeriod = 1024;
+
+using Table = std::vector<int>;
+
+SharedPtr<const Table> MakeTable() {
+    return SharedPtr<const Table>(MakeShared<Table>(64, 1));
+}
+
+AtomicSharedPtr<const Table> atomic_table(MakeTable());
+
+std::mutex mutex;
+SharedPtr<const Table> guarded_table = MakeTable();
+
+void BM_AtomicSharedPtrLoad(benchmark::State& state) {
+    int i = 0;
+    for (auto _ : state) {
+        if (state.thread_index() == 0 && ++i % kWritePeriod == 0) {
+            atomic_table.Store(MakeTable());
+        }
+        SharedPtr<const Table> table = atomic_table.Load();
+        benchmark::DoNotOptimize((*table)[0]);
+    }
+}
+
+void BM_MutexSharedPtrLoad(benchmark::State& state) {
+    int i = 0;
+    for (auto _ : state) {
+        if (state.thread_index() == 0 && ++i % kWritePeriod == 0) {
+            SharedPtr<const Table> table = MakeTable();
+            std::lock_guard guard{mutex};
+            guarded_table.Swap(table);
+        }
+        SharedPtr<const Table> table;
+        {
+            std::lock_guard guard{mutex};
+            table = guarded_table;
+        }
+        benchmark::DoNotOptimize((*table)[0]);
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_AtomicSharedPtrLoad)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK(BM_MutexSharedPtrLoad)->ThreadRange(1, 16)->UseRealTime();
@@ -0,0 +1,56 @@
+// Control block operations that used to go through virtual calls: promoting a `WeakPtr` and
+// creating/destroying objects, with `std::weak_ptr`/`std::shared_ptr` as the baseline. Built with
+// atomic counters, as the standard ones are.
+
+#include <benchmark/benchmark.h>
+
+#include "weak/weak.h"
+
+#include <memory>
+
+namespace {
+
+struct Object {
+    int value = 1;
+};
+
+void BM_WeakPtrLock(benchmark::State& state) {
+    SharedPtr<Object> ptr = MakeShared<Object>();
+    WeakPtr<Object> weak = ptr;
+    for (auto _ : state) {
+        SharedPtr<Object> locked = weak.Lock();
+        benchmark::DoNotOptimize(locked->value);
+    }
+}
+
+void BM_StdWeakPtrLock(benchmark::State& state) {
+    std::shared_ptr<Object> ptr = std::make_shared<Object>();
+    std::weak_ptr<Object> weak = ptr;
+    for (auto _ : state) {
+        std::shared_ptr<Object> locked = weak.lock();
+        benchmark::DoNotOptimize(locked->value);
+    }
+}
+
+void BM_MakeSharedWithWeak(benchmark::State& state) {
+    for (auto _ : state) {
+        SharedPtr<Object> ptr = MakeShared<Object>();
+        WeakPtr<Object> weak = ptr;
+        benchmark::DoNotOptimize(ptr.Get());
+    }
+}
+
+void BM_StdMakeSharedWithWeak(benchmark::State& state) {
+    for (auto _ : state) {
+        std::shared_ptr<Object> ptr = std::make_shared<Object>();
+        std::weak_ptr<Object> weak = ptr;
+        benchmark::DoNotOptimize(ptr.get());
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_WeakPtrLock)->ThreadRange(1, 8);
+BENCHMARK(BM_StdWeakPtrLock)->ThreadRange(1, 8);
+BENCHMARK(BM_MakeSharedWithWeak);
+BENCHMARK(BM_StdMakeSharedWithWeak);
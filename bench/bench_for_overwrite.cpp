@@ -0,0 +1,28 @@
+// Filling freshly created 1-64 MiB buffers: `MakeShared<char[]>` zeroes the buffer before it is
+// written, `MakeSharedForOverwrite<char[]>` leaves it as it comes from the allocator.
+
+#include <benchmark/benchmark.h>
+
+#include "weak/weak.h"
+
+#include <cstring>
+
+namespace {
+
+template <bool kForOverwrite>
+void BM_CreateAndFill(benchmark::State& state) {
+    size_t size = state.range(0);
+    for (auto _ : state) {
+        SharedPtr<char[]> buffer = kForOverwrite ? MakeSharedForOverwrite<char[]>(size)
+                                                 : MakeShared<char[]>(size);
+        std::memset(buffer.Get(), 0x5a, size);
+        benchmark::DoNotOptimize(buffer.Get());
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * size);
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_CreateAndFill, false)->RangeMultiplier(4)->Range(1 << 20, 64 << 20);
+BENCHMARK_TEMPLATE(BM_CreateAndFill, true)->RangeMultiplier(4)->Range(1 << 20, 64 << 20);
@@ -0,0 +1,96 @@
+// Loading a string-heavy corpus (1M identifiers drawn from a skewed vocabulary of 50k, like the
+// field and type names of parsed schemas): `Interner` against one `MakeShared` per occurrence.
+// Reports the heap per occurrence (glibc `mallinfo2`), and the cost of comparing neighbours.
+
+#include <benchmark/benchmark.h>
+
+#include "weak/interner.h"
+
+#include <malloc.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t kVocabulary = 50000;
+constexpr size_t kOccurrences = 1000000;
+
+size_t HeapInUse() {
+    return mallinfo2().uordblks;
+}
+
+const std::vector<std::string>& Corpus() {
+    static const std::vector<std::string> corpus = [] {
+        std::mt19937_64 random(1);
+        std::uniform_real_distribution<double> uniform(0, 1);
+        std::vector<std::string> words;
+        words.reserve(kOccurrences);
+        for (size_t i = 0; i < kOccurrences; ++i) {
+            // Squaring a uniform index skews occurrences towards the first names.
+            double x = uniform(random);
+            size_t index = static_cast<size_t>(x * x * kVocabulary);
+            words.push_back("com.example.schema.Message" + std::to_string(index) + ".field_name");
+        }
+        return words;
+    }();
+    return corpus;
+}
+
+template <bool kInterned>
+std::vector<SharedPtr<const std::string>> Load(Interner<std::string>& interner) {
+    std::vector<SharedPtr<const std::string>> values;
+    values.reserve(kOccurrences);
+    for (const std::string& word : Corpus()) {
+        if constexpr (kInterned) {
+            values.push_back(interner.Make(word));
+        } else {
+            values.push_back(MakeShared<const std::string>(word));
+        }
+    }
+    return values;
+}
+
+template <bool kInterned>
+void BM_LoadCorpus(benchmark::State& state) {
+    Corpus();
+    double bytes_per_occurrence = 0;
+    for (auto _ : state) {
+        Interner<std::string> interner;
+        size_t before = HeapInUse();
+        std::vector<SharedPtr<const std::string>> values = Load<kInterned>(interner);
+        bytes_per_occurrence = static_cast<double>(HeapInUse() - before) / kOccurrences;
+        state.PauseTiming();
+        values.clear();
+        state.ResumeTiming();
+    }
+    state.counters["heap_bytes_per_occurrence"] = bytes_per_occurrence;
+    state.SetItemsProcessed(state.iterations() * kOccurrences);
+}
+
+// Interned values are equal exactly when their pointers are.
+template <bool kInterned>
+void BM_CompareNeighbours(benchmark::State& state) {
+    Interner<std::string> interner;
+    std::vector<SharedPtr<const std::string>> values = Load<kInterned>(interner);
+    for (auto _ : state) {
+        size_t equal = 0;
+        for (size_t i = 1; i < values.size(); ++i) {
+            if constexpr (kInterned) {
+                equal += values[i].Get() == values[i - 1].Get();
+            } else {
+                equal += *values[i] == *values[i - 1];
+            }
+        }
+        benchmark::DoNotOptimize(equal);
+    }
+    state.SetItemsProcessed(state.iterations() * values.size());
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_LoadCorpus, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_LoadCorpus, false)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_CompareNeighbours, true)->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_CompareNeighbours, false)->Unit(benchmark::kMillisecond);
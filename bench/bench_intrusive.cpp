@@ -0,0 +1,29 @@
+// Copying and dropping an `IntrusivePtr` to one object shared by all threads, for every counter
+// policy of `RefCounted`. The non-atomic counters only run on one thread.
+
+#include <benchmark/benchmark.h>
+
+#include "intrusive/intrusive.h"
+
+namespace {
+
+template <typename Counter>
+struct Object : RefCounted<Object<Counter>, Counter, DefaultDelete> {
+    int value = 1;
+};
+
+template <typename Counter>
+void BM_IntrusiveCopy(benchmark::State& state) {
+    static IntrusivePtr<Object<Counter>> shared = MakeIntrusive<Object<Counter>>();
+    for (auto _ : state) {
+        IntrusivePtr<Object<Counter>> copy = shared;
+        benchmark::DoNotOptimize(copy->value);
+    }
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_IntrusiveCopy, SimpleCounter);
+BENCHMARK_TEMPLATE(BM_IntrusiveCopy, Simple32Counter);
+BENCHMARK_TEMPLATE(BM_IntrusiveCopy, AtomicCounter)->ThreadRange(1, 16)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_IntrusiveCopy, Atomic32Counter)->ThreadRange(1, 16)->UseRealTime();
@@ -0,0 +1,41 @@
+// Heap taken by millions of `MakeShared<int>` under the counting policy of the build, as
+// reported by the allocator (glibc `mallinfo2`). Built once with full-width and once with packed
+// counters.
+
+#include <benchmark/benchmark.h>
+
+#include "weak/weak.h"
+
+#include <malloc.h>
+
+#include <vector>
+
+namespace {
+
+size_t HeapInUse() {
+    return mallinfo2().uordblks;
+}
+
+void BM_MakeSharedIntMemory(benchmark::State& state) {
+    size_t count = state.range(0);
+    std::vector<SharedPtr<int>> ptrs;
+    ptrs.reserve(count);
+    double bytes_per_object = 0;
+    for (auto _ : state) {
+        size_t before = HeapInUse();
+        for (size_t i = 0; i < count; ++i) {
+            ptrs.push_back(MakeShared<int>(static_cast<int>(i)));
+        }
+        bytes_per_object = static_cast<double>(HeapInUse() - before) / count;
+        state.PauseTiming();
+        ptrs.clear();
+        state.ResumeTiming();
+    }
+    state.counters["block_bytes"] = sizeof(ControlBlockOwning<int>);
+    state.counters["heap_bytes_per_object"] = bytes_per_object;
+    state.SetItemsProcessed(state.iterations() * count);
+}
+
+}  // namespace
+
+BENCHMARK(BM_MakeSharedIntMemory)->Arg(1 << 20)->Arg(4 << 20)->Unit(benchmark::kMillisecond);
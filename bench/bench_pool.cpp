@@ -0,0 +1,44 @@
+// Every thread creates a batch of small objects and drops it again: `MakeSharedPooled` against
+// `MakeShared` going to the global allocator.
+
+#include <benchmark/benchmark.h>
+
+#include "weak/pool.h"
+
+#include <vector>
+
+namespace {
+
+constexpr int kBatch = 64;
+
+struct Node {
+    int value;
+    void* next;
+};
+
+template <typename Make>
+void Churn(benchmark::State& state, Make make) {
+    std::vector<SharedPtr<Node>> batch;
+    batch.reserve(kBatch);
+    for (auto _ : state) {
+        for (int i = 0; i < kBatch; ++i) {
+            batch.push_back(make(i));
+        }
+        benchmark::DoNotOptimize(batch.data());
+        batch.clear();
+    }
+    state.SetItemsProcessed(state.iterations() * kBatch);
+}
+
+void BM_MakeSharedPooled(benchmark::State& state) {
+    Churn(state, [](int i) { return MakeSharedPooled<Node>(Node{i, nullptr}); });
+}
+
+void BM_MakeShared(benchmark::State& state) {
+    Churn(state, [](int i) { return MakeShared<Node>(Node{i, nullptr}); });
+}
+
+}  // namespace
+
+BENCHMARK(BM_MakeSharedPooled)->Threads(1)->Threads(8)->Threads(32)->UseRealTime();
+BENCHMARK(BM_MakeShared)->Threads(1)->Threads(8)->Threads(32)->UseRealTime();
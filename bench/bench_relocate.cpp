@@ -0,0 +1,101 @@
+// Growing a vector to 10M pointers and erasing from its front: `RelocatingVector` relocates the
+// elements with `memmove`, `std::vector` move-constructs and destroys each of them.
+
+#include <benchmark/benchmark.h>
+
+#include "relocate/relocate.h"
+#include "unique/unique.h"
+#include "weak/weak.h"
+
+#include <vector>
+
+namespace {
+
+constexpr size_t kSize = 10'000'000;
+constexpr size_t kErased = 16;
+
+template <typename Ptr>
+Ptr MakePointer() {
+    if constexpr (std::is_same_v<Ptr, UniquePtr<int>>) {
+        return Ptr(new int(1));
+    } else {
+        static SharedPtr<int> shared = MakeShared<int>(1);
+        return shared;
+    }
+}
+
+template <typename Ptr>
+void PushBack(std::vector<Ptr>& vector, Ptr ptr) {
+    vector.push_back(std::move(ptr));
+}
+
+template <typename Ptr>
+void PushBack(RelocatingVector<Ptr>& vector, Ptr ptr) {
+    vector.PushBack(std::move(ptr));
+}
+
+template <typename Ptr>
+void EraseFront(std::vector<Ptr>& vector) {
+    vector.erase(vector.begin(), vector.begin() + kErased);
+}
+
+template <typename Ptr>
+void EraseFront(RelocatingVector<Ptr>& vector) {
+    vector.Erase(0, kErased);
+}
+
+// The pointers are created once and moved in, so the loop measures the reallocations.
+template <typename Vector, typename Ptr>
+void BM_Grow(benchmark::State& state) {
+    std::vector<Ptr> source;
+    source.reserve(kSize);
+    for (size_t i = 0; i < kSize; ++i) {
+        source.push_back(MakePointer<Ptr>());
+    }
+    for (auto _ : state) {
+        Vector vector;
+        for (Ptr& ptr : source) {
+            PushBack(vector, std::move(ptr));
+        }
+        state.PauseTiming();
+        for (size_t i = 0; i < kSize; ++i) {
+            source[i] = std::move(vector[i]);
+        }
+        state.ResumeTiming();
+    }
+}
+
+template <typename Vector, typename Ptr>
+void BM_EraseFront(benchmark::State& state) {
+    Vector vector;
+    for (size_t i = 0; i < kSize; ++i) {
+        PushBack(vector, MakePointer<Ptr>());
+    }
+    for (auto _ : state) {
+        EraseFront(vector);
+        state.PauseTiming();
+        for (size_t i = 0; i < kErased; ++i) {
+            PushBack(vector, MakePointer<Ptr>());
+        }
+        state.ResumeTiming();
+    }
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_Grow, RelocatingVector<UniquePtr<int>>, UniquePtr<int>)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Grow, std::vector<UniquePtr<int>>, UniquePtr<int>)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Grow, RelocatingVector<SharedPtr<int>>, SharedPtr<int>)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Grow, std::vector<SharedPtr<int>>, SharedPtr<int>)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_EraseFront, RelocatingVector<UniquePtr<int>>, UniquePtr<int>)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_EraseFront, std::vector<UniquePtr<int>>, UniquePtr<int>)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_EraseFront, RelocatingVector<SharedPtr<int>>, SharedPtr<int>)
+    ->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_EraseFront, std::vector<SharedPtr<int>>, SharedPtr<int>)
+    ->Unit(benchmark::kMillisecond);
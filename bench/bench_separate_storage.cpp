@@ -0,0 +1,53 @@
+// Heap kept by weakly referenced 16 KiB objects after their last `SharedPtr` is gone, as reported
+// by the allocator (glibc `mallinfo2`), and the cost of creating and dropping one. Built once with
+// the default `SW_SEPARATE_STORAGE_THRESHOLD` and once with separate storage turned off.
+
+#include <benchmark/benchmark.h>
+
+#include "weak/weak.h"
+
+#include <malloc.h>
+
+#include <vector>
+
+namespace {
+
+struct Document {
+    char bytes[16 << 10];
+};
+
+size_t HeapInUse() {
+    return mallinfo2().uordblks;
+}
+
+void BM_WeakPinnedHeap(benchmark::State& state) {
+    size_t count = state.range(0);
+    std::vector<WeakPtr<Document>> observers;
+    observers.reserve(count);
+    double bytes_per_object = 0;
+    for (auto _ : state) {
+        size_t before = HeapInUse();
+        for (size_t i = 0; i < count; ++i) {
+            SharedPtr<Document> document = MakeShared<Document>();
+            observers.push_back(document);
+        }
+        bytes_per_object = static_cast<double>(HeapInUse() - before) / count;
+        state.PauseTiming();
+        observers.clear();
+        state.ResumeTiming();
+    }
+    state.counters["separate"] = UseSeparateStorage<Document>::value;
+    state.counters["heap_bytes_per_dead_object"] = bytes_per_object;
+}
+
+void BM_MakeSharedDocument(benchmark::State& state) {
+    for (auto _ : state) {
+        SharedPtr<Document> document = MakeSharedForOverwrite<Document>();
+        benchmark::DoNotOptimize(document->bytes);
+    }
+}
+
+}  // namespace
+
+BENCHMARK(BM_WeakPinnedHeap)->Arg(10000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_MakeSharedDocument);
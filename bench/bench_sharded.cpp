@@ -0,0 +1,49 @@
+// Copying and dropping a `SharedPtr` to one object from 1-64 threads: `MakeShardedShared` against
+// `MakeShared` with atomic counters, and the same for `ShardedRefCounted` against
+// `ThreadSafeRefCounted`.
+
+#include <benchmark/benchmark.h>
+
+#include "intrusive/intrusive.h"
+#include "weak/weak.h"
+
+namespace {
+
+struct Config {
+    int value = 1;
+};
+
+template <typename Base>
+struct Node : Base {
+    int value = 1;
+};
+
+struct ShardedNode : Node<ShardedRefCounted<ShardedNode>> {};
+struct AtomicNode : Node<ThreadSafeRefCounted<AtomicNode>> {};
+
+SharedPtr<Config> sharded = MakeShardedShared<Config>();
+SharedPtr<Config> atomic = MakeShared<Config>();
+
+template <SharedPtr<Config>* kPtr>
+void BM_SharedPtrCopy(benchmark::State& state) {
+    for (auto _ : state) {
+        SharedPtr<Config> copy = *kPtr;
+        benchmark::DoNotOptimize(copy->value);
+    }
+}
+
+template <typename T>
+void BM_IntrusivePtrCopy(benchmark::State& state) {
+    static IntrusivePtr<T> shared = MakeIntrusive<T>();
+    for (auto _ : state) {
+        IntrusivePtr<T> copy = shared;
+        benchmark::DoNotOptimize(copy->value);
+    }
+}
+
+}  // namespace
+
+BENCHMARK_TEMPLATE(BM_SharedPtrCopy, &sharded)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_SharedPtrCopy, &atomic)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_IntrusivePtrCopy, ShardedNode)->ThreadRange(1, 64)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_IntrusivePtrCopy, AtomicNode)->ThreadRange(1, 64)->UseRealTime();
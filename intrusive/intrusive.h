@@ -1,18 +1,44 @@
 #pragma once
 
+#include "../relocate/relocate.h"
+#include "../sharded/sharded_counter.h"
+
+#include <atomic>
 #include <cstddef>  // for std::nullptr_t
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
 #include <utility>  // for std::exchange / std::swap
 #include <cassert>
 
-class SimpleCounter {
+// Non-atomic counter, for objects that stay on one thread.
+template <typename Int>
+class BasicSimpleCounter {
 public:
+    BasicSimpleCounter() = default;
+
+    // A copy of an object is not referenced by anyone yet.
+    BasicSimpleCounter(const BasicSimpleCounter&) {
+    }
+
+    BasicSimpleCounter& operator=(const BasicSimpleCounter&) {
+        return *this;
+    }
+
+    // Throws `std::overflow_error` rather than letting the count reach the immortal sentinel.
     size_t IncRef() {
+        if (count_ == kImmortal) {
+            return count_;
+        }
+        if (count_ == kImmortal - 1) {
+            throw std::overflow_error("reference counter overflow");
+        }
         ++count_;
         return count_;
     };
     size_t DecRef() {
-        if (count_ == 0) {
-            return 0;
+        if (count_ == 0 || count_ == kImmortal) {
+            return count_;
         }
         return --count_;
     };
@@ -21,10 +47,76 @@ public:
         return count_;
     };
 
+    void SetImmortal() {
+        count_ = kImmortal;
+    }
+
 private:
-    size_t count_ = 0;
+    static constexpr Int kImmortal = std::numeric_limits<Int>::max();
+
+    Int count_ = 0;
 };
 
+// Counter for objects shared between threads. Increments are relaxed: a new reference is always
+// made from an existing one. The decrement is acq_rel, so everything done through other references
+// happens before the destruction.
+template <typename Int>
+class BasicAtomicCounter {
+public:
+    BasicAtomicCounter() = default;
+
+    // A copy of an object is not referenced by anyone yet.
+    BasicAtomicCounter(const BasicAtomicCounter&) {
+    }
+
+    BasicAtomicCounter& operator=(const BasicAtomicCounter&) {
+        return *this;
+    }
+
+    // An immortal counter is only read, so its cache line is not bounced between cores.
+    // Throws `std::overflow_error` past `kMaxCount`. The gap up to the immortal sentinel absorbs
+    // the increments of threads that race past the check before the first one backs out.
+    size_t IncRef() {
+        if (count_.load(std::memory_order_relaxed) == kImmortal) {
+            return kImmortal;
+        }
+        Int old = count_.fetch_add(1, std::memory_order_relaxed);
+        if (old >= kMaxCount) {
+            count_.fetch_sub(1, std::memory_order_relaxed);
+            throw std::overflow_error("reference counter overflow");
+        }
+        return old + 1;
+    };
+    size_t DecRef() {
+        if (count_.load(std::memory_order_relaxed) == kImmortal) {
+            return kImmortal;
+        }
+        return count_.fetch_sub(1, std::memory_order_acq_rel) - 1;
+    };
+
+    size_t RefCount() const {
+        return count_.load(std::memory_order_relaxed);
+    };
+
+    // Must be called before the object is shared with other threads.
+    void SetImmortal() {
+        count_.store(kImmortal, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr Int kImmortal = std::numeric_limits<Int>::max();
+    static constexpr Int kMaxCount = kImmortal / 2;
+
+    std::atomic<Int> count_ = 0;
+};
+
+using SimpleCounter = BasicSimpleCounter<size_t>;
+using AtomicCounter = BasicAtomicCounter<size_t>;
+
+// 32-bit counters save 4 bytes when the object has a spare slot next to the counter.
+using Simple32Counter = BasicSimpleCounter<uint32_t>;
+using Atomic32Counter = BasicAtomicCounter<uint32_t>;
+
 struct DefaultDelete {
     template <typename T>
     static void Destroy(T* object) {
@@ -53,6 +145,12 @@ public:
         return counter_.RefCount();
     };
 
+    // Turn reference counting off: `IncRef`/`DecRef` no longer write to the counter and the
+    // object is never destroyed by them. Meant for static singletons and sentinels.
+    void SetImmortal() {
+        counter_.SetImmortal();
+    }
+
 private:
     Counter counter_;
 };
@@ -60,6 +158,162 @@ private:
 template <typename Derived, typename D = DefaultDelete>
 using SimpleRefCounted = RefCounted<Derived, SimpleCounter, D>;
 
+template <typename Derived, typename D = DefaultDelete>
+using ThreadSafeRefCounted = RefCounted<Derived, AtomicCounter, D>;
+
+// For the few objects copied from every core at once, see `ShardedCounter`.
+template <typename Derived, typename D = DefaultDelete>
+using ShardedRefCounted = RefCounted<Derived, ShardedCounter<>, D>;
+
+template <typename T>
+class IntrusiveWeakPtr;
+
+// Side block of a `RefCountedWithWeak` object that has weak references. Once it exists, it holds
+// the strong counter too. The strong references together own one weak reference, so the block
+// outlives the object.
+class WeakRefBlock {
+public:
+    explicit WeakRefBlock(size_t strong) : strong_(strong) {
+    }
+
+    void IncStrong() {
+        strong_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Returns true if the last strong reference is gone.
+    bool DecStrong() {
+        return strong_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    // Used to lock an `IntrusiveWeakPtr`: fails if the object is already destroyed.
+    bool TryIncStrong() {
+        size_t strong = strong_.load(std::memory_order_relaxed);
+        do {
+            if (strong == 0) {
+                return false;
+            }
+        } while (!strong_.compare_exchange_weak(strong, strong + 1, std::memory_order_relaxed));
+        return true;
+    }
+
+    size_t StrongCount() const {
+        return strong_.load(std::memory_order_relaxed);
+    }
+
+    void IncWeak() {
+        weak_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void DecWeak() {
+        if (weak_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+            delete this;
+        }
+    }
+
+private:
+    template <typename Derived, typename Deleter>
+    friend class RefCountedWithWeak;
+
+    std::atomic<size_t> strong_;
+    std::atomic<size_t> weak_ = 1;
+};
+
+// Thread-safe intrusive counting with support for `IntrusiveWeakPtr`, in one word per object.
+//
+// The word holds the strong counter until the first weak reference is made. Then a `WeakRefBlock`
+// is allocated, the counter moves there and the word points to it (tagged with `kSideFlag`).
+// Objects that are never weakly referenced cost no extra allocation.
+template <typename Derived, typename Deleter = DefaultDelete>
+class RefCountedWithWeak {
+public:
+    RefCountedWithWeak() = default;
+
+    // A copy of an object is not referenced by anyone yet.
+    RefCountedWithWeak(const RefCountedWithWeak&) {
+    }
+
+    RefCountedWithWeak& operator=(const RefCountedWithWeak&) {
+        return *this;
+    }
+
+    void IncRef() {
+        uintptr_t word = word_.load(std::memory_order_acquire);
+        while (!(word & kSideFlag)) {
+            if (word_.compare_exchange_weak(word, word + kOne, std::memory_order_acquire)) {
+                return;
+            }
+        }
+        Side(word)->IncStrong();
+    }
+
+    void DecRef() {
+        uintptr_t word = word_.load(std::memory_order_acquire);
+        while (!(word & kSideFlag)) {
+            if (word_.compare_exchange_weak(word, word - kOne, std::memory_order_acq_rel,
+                                            std::memory_order_acquire)) {
+                if (word == kOne) {
+                    Deleter::Destroy(static_cast<Derived*>(this));
+                }
+                return;
+            }
+        }
+        WeakRefBlock* side = Side(word);
+        if (side->DecStrong()) {
+            Deleter::Destroy(static_cast<Derived*>(this));
+            side->DecWeak();
+        }
+    }
+
+    size_t RefCount() const {
+        uintptr_t word = word_.load(std::memory_order_acquire);
+        if (word & kSideFlag) {
+            return Side(word)->StrongCount();
+        }
+        return word / kOne;
+    }
+
+private:
+    template <typename T>
+    friend class IntrusiveWeakPtr;
+
+    static constexpr uintptr_t kSideFlag = 1;
+    static constexpr uintptr_t kOne = 2;
+
+    static WeakRefBlock* Side(uintptr_t word) {
+        return reinterpret_cast<WeakRefBlock*>(word & ~kSideFlag);
+    }
+
+    // Returns the side block with a new weak reference, creating the block on first use.
+    // The caller holds a strong reference.
+    WeakRefBlock* AcquireWeakRef() {
+        uintptr_t word = word_.load(std::memory_order_acquire);
+        if (!(word & kSideFlag)) {
+            auto* side = new WeakRefBlock(word / kOne);
+            uintptr_t tagged = reinterpret_cast<uintptr_t>(side) | kSideFlag;
+            while (!word_.compare_exchange_weak(word, tagged, std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+                if (word & kSideFlag) {
+                    // Another thread installed its block first.
+                    delete side;
+                    break;
+                }
+                side->strong_.store(word / kOne, std::memory_order_relaxed);
+            }
+            if (!(word & kSideFlag)) {
+                word = tagged;
+            }
+        }
+        WeakRefBlock* side = Side(word);
+        side->IncWeak();
+        return side;
+    }
+
+    std::atomic<uintptr_t> word_ = 0;
+};
+
+// Makes `IntrusivePtr` take over a reference the caller already holds instead of adding one.
+struct AdoptRefTag {};
+
 template <typename T>
 class IntrusivePtr {
     template <typename Y>
@@ -75,6 +329,10 @@ public:
         }
     };
 
+    // Takes over a reference released by `Detach()`, the counter is not touched.
+    IntrusivePtr(T* ptr, AdoptRefTag) : ptr_(ptr) {
+    }
+
     template <typename Y>
     IntrusivePtr(const IntrusivePtr<Y>& other) {
         ptr_ = other.ptr_;
@@ -161,6 +419,12 @@ public:
         std::swap(ptr_, other.ptr_);
     };
 
+    // Gives up the pointer without decrementing the counter: the caller now owns the reference
+    // and hands it back with `IntrusivePtr(ptr, AdoptRefTag{})`.
+    [[nodiscard]] T* Detach() {
+        return std::exchange(ptr_, nullptr);
+    }
+
     // Observers
     T* Get() const {
         return ptr_;
@@ -193,7 +457,133 @@ private:
     T* ptr_;
 };
 
+template <typename T>
+struct IsTriviallyRelocatable<IntrusivePtr<T>> : std::true_type {};
+
 template <typename T, typename... Args>
 IntrusivePtr<T> MakeIntrusive(Args&&... args) {
     return IntrusivePtr{new T{std::forward<Args>(args)...}};
 }
+
+// The rvalue overloads move the reference into the result instead of taking a new one.
+template <typename T, typename U>
+IntrusivePtr<T> StaticPointerCast(const IntrusivePtr<U>& ptr) {
+    return IntrusivePtr<T>{static_cast<T*>(ptr.Get())};
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> StaticPointerCast(IntrusivePtr<U>&& ptr) {
+    return IntrusivePtr<T>{static_cast<T*>(ptr.Detach()), AdoptRefTag{}};
+}
+
+// An empty result if the cast fails; `ptr` is left untouched then.
+template <typename T, typename U>
+IntrusivePtr<T> DynamicPointerCast(const IntrusivePtr<U>& ptr) {
+    return IntrusivePtr<T>{dynamic_cast<T*>(ptr.Get())};
+}
+
+template <typename T, typename U>
+IntrusivePtr<T> DynamicPointerCast(IntrusivePtr<U>&& ptr) {
+    if (T* cast = dynamic_cast<T*>(ptr.Get())) {
+        static_cast<void>(ptr.Detach());
+        return IntrusivePtr<T>{cast, AdoptRefTag{}};
+    }
+    return IntrusivePtr<T>{};
+}
+
+// https://en.cppreference.com/w/cpp/memory/weak_ptr, for `RefCountedWithWeak` objects.
+// Stores the object pointer and its `WeakRefBlock`.
+template <typename T>
+class IntrusiveWeakPtr {
+    template <typename Y>
+    friend class IntrusiveWeakPtr;
+
+public:
+    // Constructors
+    IntrusiveWeakPtr() : ptr_(nullptr), block_(nullptr) {
+    }
+
+    IntrusiveWeakPtr(std::nullptr_t) : IntrusiveWeakPtr() {
+    }
+
+    template <typename Y>
+    IntrusiveWeakPtr(const IntrusivePtr<Y>& other)
+        : ptr_(other.Get()), block_(ptr_ ? other.Get()->AcquireWeakRef() : nullptr) {
+    }
+
+    IntrusiveWeakPtr(const IntrusiveWeakPtr& other) : ptr_(other.ptr_), block_(other.block_) {
+        if (block_) {
+            block_->IncWeak();
+        }
+    }
+
+    template <typename Y>
+    IntrusiveWeakPtr(const IntrusiveWeakPtr<Y>& other) : ptr_(other.ptr_), block_(other.block_) {
+        if (block_) {
+            block_->IncWeak();
+        }
+    }
+
+    IntrusiveWeakPtr(IntrusiveWeakPtr&& other)
+        : ptr_(std::exchange(other.ptr_, nullptr)), block_(std::exchange(other.block_, nullptr)) {
+    }
+
+    template <typename Y>
+    IntrusiveWeakPtr(IntrusiveWeakPtr<Y>&& other)
+        : ptr_(std::exchange(other.ptr_, nullptr)), block_(std::exchange(other.block_, nullptr)) {
+    }
+
+    // `operator=`-s
+    IntrusiveWeakPtr& operator=(const IntrusiveWeakPtr& other) {
+        IntrusiveWeakPtr{other}.Swap(*this);
+        return *this;
+    }
+
+    IntrusiveWeakPtr& operator=(IntrusiveWeakPtr&& other) {
+        IntrusiveWeakPtr{std::move(other)}.Swap(*this);
+        return *this;
+    }
+
+    // Destructor
+    ~IntrusiveWeakPtr() {
+        if (block_) {
+            block_->DecWeak();
+        }
+    }
+
+    // Modifiers
+    void Reset() {
+        IntrusiveWeakPtr{}.Swap(*this);
+    }
+
+    void Swap(IntrusiveWeakPtr& other) {
+        std::swap(ptr_, other.ptr_);
+        std::swap(block_, other.block_);
+    }
+
+    // Observers
+    size_t UseCount() const {
+        if (block_) {
+            return block_->StrongCount();
+        }
+        return 0;
+    }
+
+    bool Expired() const {
+        return UseCount() == 0;
+    }
+
+    IntrusivePtr<T> Lock() const {
+        if (block_ && block_->TryIncStrong()) {
+            return IntrusivePtr<T>{ptr_, AdoptRefTag{}};
+        }
+        return IntrusivePtr<T>{};
+    }
+
+private:
+    T* ptr_;
+    WeakRefBlock* block_;
+};
+
+template <typename T>
+struct IsTriviallyRelocatable<IntrusiveWeakPtr<T>> : std::true_type {};
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>  // size_t
+#include <cstring>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Whether moving a `T` to a new address and destroying the source can be replaced by copying its
+// bytes. True for trivially copyable types; smart pointers specialize it next to their
+// definitions, since their state is just pointers to objects that don't point back at them.
+template <typename T>
+struct IsTriviallyRelocatable : std::is_trivially_copyable<T> {};
+
+template <typename T>
+inline constexpr bool kTriviallyRelocatable = IsTriviallyRelocatable<std::remove_cv_t<T>>::value;
+
+// Moves `count` objects from `src` to uninitialized memory at `dst` and ends the lifetime of the
+// source objects. The ranges may overlap if `dst` is below `src`.
+template <typename T>
+void RelocateForward(T* src, size_t count, T* dst) noexcept {
+    if constexpr (kTriviallyRelocatable<T>) {
+        if (count != 0) {
+            std::memmove(static_cast<void*>(dst), static_cast<const void*>(src),
+                         count * sizeof(T));
+        }
+    } else {
+        static_assert(std::is_nothrow_move_constructible_v<T>);
+        for (size_t i = 0; i < count; ++i) {
+            new (static_cast<void*>(dst + i)) T(std::move(src[i]));
+            src[i].~T();
+        }
+    }
+}
+
+// Vector that grows and erases by relocating its elements: for trivially relocatable types that
+// is one `memmove` instead of a move constructor and a destructor call per element.
+template <typename T>
+class RelocatingVector {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    RelocatingVector() = default;
+
+    RelocatingVector(const RelocatingVector&) = delete;
+    RelocatingVector& operator=(const RelocatingVector&) = delete;
+
+    RelocatingVector(RelocatingVector&& other) noexcept
+        : data_(std::exchange(other.data_, nullptr)),
+          size_(std::exchange(other.size_, 0)),
+          capacity_(std::exchange(other.capacity_, 0)) {
+    }
+
+    RelocatingVector& operator=(RelocatingVector&& other) noexcept {
+        RelocatingVector{std::move(other)}.Swap(*this);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~RelocatingVector() {
+        Clear();
+        Deallocate(data_, capacity_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reserve(size_t capacity) {
+        if (capacity <= capacity_) {
+            return;
+        }
+        T* data = std::allocator<T>().allocate(capacity);
+        RelocateForward(data_, size_, data);
+        Deallocate(data_, capacity_);
+        data_ = data;
+        capacity_ = capacity;
+    }
+
+    // `args` may refer to elements of this vector.
+    template <typename... Args>
+    T& EmplaceBack(Args&&... args) {
+        if (size_ != capacity_) {
+            T* element = new (static_cast<void*>(data_ + size_)) T(std::forward<Args>(args)...);
+            ++size_;
+            return *element;
+        }
+        // Grows: the new element is constructed before the old ones are relocated away.
+        size_t capacity = capacity_ ? 2 * capacity_ : 1;
+        T* data = std::allocator<T>().allocate(capacity);
+        T* element;
+        try {
+            element = new (static_cast<void*>(data + size_)) T(std::forward<Args>(args)...);
+        } catch (...) {
+            Deallocate(data, capacity);
+            throw;
+        }
+        RelocateForward(data_, size_, data);
+        Deallocate(data_, capacity_);
+        data_ = data;
+        capacity_ = capacity;
+        ++size_;
+        return *element;
+    }
+
+    void PushBack(T value) {
+        EmplaceBack(std::move(value));
+    }
+
+    void PopBack() {
+        assert(size_ != 0);
+        data_[--size_].~T();
+    }
+
+    // Erases `[first, last)` and closes the gap by relocating the tail.
+    void Erase(size_t first, size_t last) {
+        assert(first <= last && last <= size_);
+        for (size_t i = first; i < last; ++i) {
+            data_[i].~T();
+        }
+        RelocateForward(data_ + last, size_ - last, data_ + first);
+        size_ -= last - first;
+    }
+
+    void Erase(size_t index) {
+        Erase(index, index + 1);
+    }
+
+    void Clear() {
+        for (size_t i = 0; i < size_; ++i) {
+            data_[i].~T();
+        }
+        size_ = 0;
+    }
+
+    void Swap(RelocatingVector& other) {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    size_t Size() const {
+        return size_;
+    }
+
+    size_t Capacity() const {
+        return capacity_;
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    T& operator[](size_t index) {
+        assert(index < size_);
+        return data_[index];
+    }
+
+    const T& operator[](size_t index) const {
+        assert(index < size_);
+        return data_[index];
+    }
+
+    T* begin() {
+        return data_;
+    }
+
+    T* end() {
+        return data_ + size_;
+    }
+
+    const T* begin() const {
+        return data_;
+    }
+
+    const T* end() const {
+        return data_ + size_;
+    }
+
+private:
+    static void Deallocate(T* data, size_t capacity) {
+        if (data) {
+            std::allocator<T>().deallocate(data, capacity);
+        }
+    }
+
+    T* data_ = nullptr;
+    size_t size_ = 0;
+    size_t capacity_ = 0;
+};
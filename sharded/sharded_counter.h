@@ -0,0 +1,144 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+// Number of the CPU the calling thread runs on, or a per-thread number where it is unknown.
+inline size_t CurrentCpu() {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0) {
+        return cpu;
+    }
+#endif
+    thread_local size_t index = std::hash<std::thread::id>{}(std::this_thread::get_id());
+    return index;
+}
+
+// Reference counter for the few objects that are copied from every core at once.
+//
+// References are counted in per-CPU slots, each on its own cache line, and in a central counter
+// that always holds at least one of them. So a decrement taken from a slot is never the last one,
+// and an increment/decrement pair on one core touches only the slot of that core. A decrement
+// that finds its slot empty takes the reference from another slot or from the central counter.
+// Only when the central counter is down to its last reference, the slots are folded into it for
+// good and the counter works as a plain atomic from then on.
+//
+// Costs `kShards + 1` cache lines. `DecRef` returns 0 for the last reference; other return values
+// of `IncRef`/`DecRef` are not exact counts.
+template <size_t kShards = 16>
+class ShardedCounter {
+public:
+    ShardedCounter() = default;
+
+    explicit ShardedCounter(size_t initial) : central_(initial) {
+    }
+
+    // A copy of an object is not referenced by anyone yet.
+    ShardedCounter(const ShardedCounter&) {
+    }
+
+    ShardedCounter& operator=(const ShardedCounter&) {
+        return *this;
+    }
+
+    size_t IncRef(size_t n = 1) {
+        // The first reference always goes to the central counter.
+        if (central_.load(std::memory_order_relaxed) != 0) {
+            uint64_t word = slots_[CurrentCpu() % kShards].word.fetch_add(
+                n * kOne, std::memory_order_relaxed);
+            if (!(word & kFolded)) {
+                return word / kOne + n;
+            }
+        }
+        return central_.fetch_add(n, std::memory_order_relaxed) + n;
+    }
+
+    size_t DecRef(size_t n = 1) {
+        if (sharded_.load(std::memory_order_acquire)) {
+            size_t own = CurrentCpu() % kShards;
+            for (size_t i = 0; i < kShards; ++i) {
+                if (TryTake(slots_[(own + i) % kShards].word, n)) {
+                    return 1;
+                }
+            }
+            uint64_t central = central_.load(std::memory_order_relaxed);
+            while (central > n) {
+                if (central_.compare_exchange_weak(central, central - n, std::memory_order_acq_rel,
+                                                   std::memory_order_relaxed)) {
+                    return 1;
+                }
+            }
+            Fold();
+        }
+        return central_.fetch_sub(n, std::memory_order_acq_rel) - n;
+    }
+
+    // Used to promote weak references: fails once the count has reached zero.
+    bool TryIncRef() {
+        uint64_t central = central_.load(std::memory_order_relaxed);
+        while (central != 0) {
+            if (central_.compare_exchange_weak(central, central + 1, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Approximate while other threads change the counter.
+    size_t RefCount() const {
+        uint64_t count = central_.load(std::memory_order_relaxed);
+        for (const Slot& slot : slots_) {
+            uint64_t word = slot.word.load(std::memory_order_relaxed);
+            if (!(word & kFolded)) {
+                count += word / kOne;
+            }
+        }
+        return count & (kBias - 1);
+    }
+
+private:
+    // Slot words hold the count above the `kFolded` bit.
+    static constexpr uint64_t kFolded = 1;
+    static constexpr uint64_t kOne = 2;
+    static constexpr uint64_t kBias = uint64_t{1} << 48;
+
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> word = 0;
+    };
+
+    static bool TryTake(std::atomic<uint64_t>& slot, size_t n) {
+        uint64_t word = slot.load(std::memory_order_relaxed);
+        while (!(word & kFolded) && word >= n * kOne) {
+            if (slot.compare_exchange_weak(word, word - n * kOne, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Moves the slots into the central counter and stops using them. The bias keeps decrements
+    // that already go to the central counter from reaching zero before every slot is folded.
+    void Fold() {
+        central_.fetch_add(kBias, std::memory_order_relaxed);
+        if (sharded_.exchange(false, std::memory_order_acq_rel)) {
+            for (Slot& slot : slots_) {
+                uint64_t word = slot.word.exchange(kFolded, std::memory_order_acquire);
+                central_.fetch_add(word / kOne, std::memory_order_relaxed);
+            }
+        }
+        central_.fetch_sub(kBias, std::memory_order_release);
+    }
+
+    alignas(64) std::atomic<uint64_t> central_ = 0;
+    std::atomic<bool> sharded_ = true;
+    Slot slots_[kShards];
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Counts live instances, to check that every object is destroyed exactly once.
+struct Tracked {
+    static inline std::atomic<int> alive = 0;
+
+    Tracked(int value = 0) : value(value) {
+        ++alive;
+    }
+
+    Tracked(const Tracked& other) : value(other.value) {
+        ++alive;
+    }
+
+    ~Tracked() {
+        --alive;
+    }
+
+    int value;
+};
+
+// Runs `body(index)` on `threads` threads at once and waits for all of them.
+template <typename Body>
+void RunConcurrently(int threads, Body body) {
+    std::vector<std::thread> workers;
+    for (int i = 0; i < threads; ++i) {
+        workers.emplace_back([&body, i] { body(i); });
+    }
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
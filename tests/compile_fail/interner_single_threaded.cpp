@@ -0,0 +1,8 @@
+// Must not compile: interned values are shared by every thread that makes an equal one, the
+// single-threaded counters would race.
+#include "weak/interner.h"
+
+int main() {
+    Interner<int> interner;
+    return *interner.Make(1);
+}
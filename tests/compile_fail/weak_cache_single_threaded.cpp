@@ -0,0 +1,8 @@
+// Must not compile: the cache hands its values to other threads, the single-threaded counters
+// would race.
+#include "weak/weak_cache.h"
+
+int main() {
+    WeakValueCache<int, int> cache;
+    return cache.TryLock(1) ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/weak.h"
+
+#include <memory_resource>
+#include <new>
+
+namespace {
+
+struct Stats {
+    int allocations = 0;
+    int deallocations = 0;
+    size_t live_bytes = 0;
+};
+
+// Records every allocation in `stats`, optionally fails the next one.
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+
+    explicit CountingAllocator(Stats* stats, bool fail = false) : stats(stats), fail(fail) {
+    }
+
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U>& other) : stats(other.stats), fail(other.fail) {
+    }
+
+    T* allocate(size_t n) {
+        if (fail) {
+            throw std::bad_alloc();
+        }
+        ++stats->allocations;
+        stats->live_bytes += n * sizeof(T);
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        ++stats->deallocations;
+        stats->live_bytes -= n * sizeof(T);
+        std::allocator<T>{}.deallocate(ptr, n);
+    }
+
+    template <typename U>
+    bool operator==(const CountingAllocator<U>& other) const {
+        return stats == other.stats;
+    }
+
+    template <typename U>
+    bool operator!=(const CountingAllocator<U>& other) const {
+        return stats != other.stats;
+    }
+
+    Stats* stats;
+    bool fail;
+};
+
+}  // namespace
+
+TEST_CASE("AllocateShared takes the block from the allocator") {
+    Tracked::alive = 0;
+    Stats stats;
+    {
+        SharedPtr<Tracked> ptr = AllocateShared<Tracked>(CountingAllocator<Tracked>(&stats), 3);
+        REQUIRE(ptr->value == 3);
+        REQUIRE(stats.allocations == 1);
+        REQUIRE(stats.live_bytes >= sizeof(Tracked));
+
+        WeakPtr<Tracked> weak = ptr;
+        SharedPtr<Tracked> copy = ptr;
+        ptr.Reset();
+        copy.Reset();
+        // The object is gone, its memory stays with the block until the last weak reference.
+        REQUIRE(Tracked::alive == 0);
+        REQUIRE(weak.Expired());
+        REQUIRE(stats.deallocations == 0);
+    }
+    REQUIRE(stats.deallocations == 1);
+    REQUIRE(stats.live_bytes == 0);
+}
+
+TEST_CASE("AllocateShared works with polymorphic allocators") {
+    char buffer[1024];
+    std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer),
+                                                 std::pmr::null_memory_resource());
+    std::pmr::polymorphic_allocator<int> alloc(&resource);
+    std::vector<SharedPtr<int>> ptrs;
+    for (int i = 0; i < 10; ++i) {
+        ptrs.push_back(AllocateShared<int>(alloc, i));
+    }
+    for (int i = 0; i < 10; ++i) {
+        REQUIRE(*ptrs[i] == i);
+        REQUIRE(static_cast<void*>(ptrs[i].Get()) >= static_cast<void*>(buffer));
+        REQUIRE(static_cast<void*>(ptrs[i].Get()) < static_cast<void*>(buffer + sizeof(buffer)));
+    }
+}
+
+TEST_CASE("The allocator-carrying constructor allocates only the block") {
+    Stats stats;
+    int deleted = 0;
+    auto deleter = [&deleted](int* ptr) {
+        ++deleted;
+        delete ptr;
+    };
+    {
+        SharedPtr<int> ptr(new int(4), deleter, CountingAllocator<int>(&stats));
+        REQUIRE(*ptr == 4);
+        REQUIRE(stats.allocations == 1);
+        SharedPtr<int> copy = ptr;
+    }
+    REQUIRE(deleted == 1);
+    REQUIRE(stats.deallocations == 1);
+    REQUIRE(stats.live_bytes == 0);
+
+    REQUIRE_THROWS_AS(SharedPtr<int>(new int(5), deleter, CountingAllocator<int>(&stats, true)),
+                      std::bad_alloc);
+    // The pointer is released when the block can't be allocated.
+    REQUIRE(deleted == 2);
+}
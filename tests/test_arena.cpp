@@ -0,0 +1,80 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "arena/arena.h"
+#include "weak/weak.h"
+
+#include <cstdint>
+#include <string>
+
+namespace {
+
+struct Node {
+    Node(std::string name, SharedPtr<Node> next) : name(std::move(name)), next(std::move(next)) {
+    }
+
+    std::string name;
+    SharedPtr<Node> next;
+    Tracked tracked;
+};
+
+}  // namespace
+
+TEST_CASE("Arena hands out aligned memory from its chunks") {
+    Arena arena(1024);
+    for (size_t alignment : {1, 2, 8, 16, 64, 256}) {
+        void* memory = arena.Allocate(24, alignment);
+        REQUIRE(reinterpret_cast<uintptr_t>(memory) % alignment == 0);
+    }
+    size_t reserved = arena.BytesReserved();
+    REQUIRE(reserved > 1024);
+    REQUIRE(reserved < 2 * 1024);
+
+    // Larger than a chunk: gets a chunk of its own.
+    auto* big = static_cast<char*>(arena.Allocate(10000, 8));
+    big[9999] = 1;
+    REQUIRE(arena.BytesReserved() > reserved + 10000);
+}
+
+TEST_CASE("Arena pointers run destructors and nothing else") {
+    STATIC_REQUIRE(sizeof(ArenaUniquePtr<Tracked>) == sizeof(Tracked*));
+
+    Tracked::alive = 0;
+    Arena arena;
+    {
+        ArenaUniquePtr<Tracked> unique = MakeUniqueIn<Tracked>(arena, 1);
+        ArenaUniquePtr<int> trivial = MakeUniqueIn<int>(arena, 2);
+        REQUIRE(unique->value == 1);
+        REQUIRE(*trivial == 2);
+        REQUIRE(Tracked::alive == 1);
+
+        unique.Reset();
+        REQUIRE(Tracked::alive == 0);
+    }
+    // Both objects came from the first chunk.
+    REQUIRE(arena.BytesReserved() < 2 * Arena::kDefaultChunkSize);
+}
+
+TEST_CASE("Shared graphs live in one arena") {
+    Tracked::alive = 0;
+    Arena arena;
+    {
+        SharedPtr<Node> list;
+        for (int i = 0; i < 1000; ++i) {
+            list = MakeSharedIn<Node>(arena, std::to_string(i), std::move(list));
+        }
+        REQUIRE(Tracked::alive == 1000);
+        REQUIRE(list->name == "999");
+        REQUIRE(list->next->name == "998");
+
+        WeakPtr<Node> weak = list->next;
+        SharedPtr<Node> head = list;
+        list.Reset();
+        REQUIRE(!weak.Expired());
+        head.Reset();
+        REQUIRE(weak.Expired());
+        REQUIRE(Tracked::alive == 0);
+    }
+    // A thousand nodes with their blocks, in a few chunks.
+    REQUIRE(arena.BytesReserved() < 1000 * (sizeof(Node) + 64) + 2 * Arena::kDefaultChunkSize);
+}
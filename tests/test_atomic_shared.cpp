@@ -0,0 +1,142 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/atomic_shared.h"
+
+// The header has to compile under every policy, `AtomicSharedPtr` only works with thread-safe ones.
+#if defined(SW_ATOMIC_COUNTERS) || defined(SW_BIASED_COUNTERS)
+
+TEST_CASE("AtomicSharedPtr loads what was stored") {
+    Tracked::alive = 0;
+    {
+        AtomicSharedPtr<Tracked> atomic;
+        REQUIRE(!atomic.Load());
+
+        SharedPtr<Tracked> first = MakeShared<Tracked>(1);
+        atomic.Store(first);
+        SharedPtr<Tracked> loaded = atomic.Load();
+        REQUIRE(loaded.Get() == first.Get());
+
+        SharedPtr<Tracked> old = atomic.Exchange(MakeShared<Tracked>(2));
+        REQUIRE(old.Get() == first.Get());
+        REQUIRE(atomic.Load()->value == 2);
+
+        atomic.Store(nullptr);
+        REQUIRE(!atomic.Load());
+        REQUIRE(Tracked::alive == 1);
+    }
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("AtomicSharedPtr gives the reserve back") {
+    SharedPtr<int> ptr = MakeShared<int>(5);
+    {
+        AtomicSharedPtr<int> atomic(ptr);
+        SharedPtr<int> loaded = atomic.Load();
+        REQUIRE(*loaded == 5);
+    }
+    REQUIRE(ptr.UseCount() == 1);
+
+    SharedPtr<int> plain(new int(6));
+    {
+        AtomicSharedPtr<int> atomic(plain);
+        REQUIRE(atomic.Load().Get() == plain.Get());
+    }
+    REQUIRE(plain.UseCount() == 1);
+}
+
+TEST_CASE("AtomicSharedPtr keeps aliased pointers") {
+    struct Pair {
+        int first;
+        int second;
+    };
+    SharedPtr<Pair> pair = MakeShared<Pair>(Pair{1, 2});
+    SharedPtr<int> second(pair, &pair->second);
+    {
+        AtomicSharedPtr<int> atomic(second);
+        SharedPtr<int> loaded = atomic.Load();
+        REQUIRE(loaded.Get() == &pair->second);
+        REQUIRE(*loaded == 2);
+        REQUIRE(loaded.OwnerEqual(pair));
+    }
+    second.Reset();
+    REQUIRE(pair.UseCount() == 1);
+}
+
+TEST_CASE("CompareExchange replaces only the expected pointer") {
+    SharedPtr<int> first = MakeShared<int>(1);
+    SharedPtr<int> second = MakeShared<int>(2);
+    AtomicSharedPtr<int> atomic(first);
+
+    SharedPtr<int> expected = second;
+    REQUIRE(!atomic.CompareExchange(expected, MakeShared<int>(3)));
+    REQUIRE(expected.Get() == first.Get());
+
+    REQUIRE(atomic.CompareExchange(expected, second));
+    REQUIRE(atomic.Load().Get() == second.Get());
+}
+
+TEST_CASE("Loads past the refill threshold are counted") {
+    Tracked::alive = 0;
+    {
+        AtomicSharedPtr<Tracked> atomic(MakeShared<Tracked>(1));
+        std::vector<SharedPtr<Tracked>> held;
+        for (int i = 0; i < 100000; ++i) {
+            SharedPtr<Tracked> loaded = atomic.Load();
+            if (i % 3 == 0) {
+                held.push_back(std::move(loaded));
+            }
+        }
+        REQUIRE(held.front().UseCount() >= held.size());
+        atomic.Store(nullptr);
+        REQUIRE(held.front().UseCount() == held.size());
+    }
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("Readers race with a writer", "[threads]") {
+    Tracked::alive = 0;
+    std::atomic<int> mismatches = 0;
+    {
+        AtomicSharedPtr<Tracked> atomic(MakeShared<Tracked>(0));
+        RunConcurrently(4, [&](int index) {
+            if (index == 0) {
+                for (int i = 1; i <= 2000; ++i) {
+                    atomic.Store(MakeShared<Tracked>(i));
+                }
+                return;
+            }
+            int last = 0;
+            for (int i = 0; i < 50000; ++i) {
+                SharedPtr<Tracked> loaded = atomic.Load();
+                // A single writer publishes increasing values.
+                mismatches += loaded->value < last;
+                last = loaded->value;
+            }
+        });
+        REQUIRE(atomic.Load()->value == 2000);
+    }
+    FlushDeferredReleases();
+    REQUIRE(mismatches == 0);
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("CompareExchange loops don't lose updates", "[threads]") {
+    AtomicSharedPtr<int> atomic(MakeShared<int>(0));
+    RunConcurrently(4, [&](int) {
+        for (int i = 0; i < 5000; ++i) {
+            SharedPtr<int> expected = atomic.Load();
+            while (!atomic.CompareExchange(expected, MakeShared<int>(*expected + 1))) {
+            }
+        }
+    });
+    REQUIRE(*atomic.Load() == 20000);
+}
+
+#else
+
+TEST_CASE("atomic_shared.h compiles with single-threaded counters") {
+    SUCCEED();
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/weak.h"
+
+#include <thread>
+
+struct Outer {
+    SharedPtr<Tracked> inner;
+};
+
+TEST_CASE("The creating thread counts without the shared counter") {
+    Tracked::alive = 0;
+    SharedPtr<Tracked> ptr = MakeShared<Tracked>(1);
+    {
+        SharedPtr<Tracked> copy = ptr;
+        WeakPtr<Tracked> weak = copy;
+        REQUIRE(ptr.UseCount() == 2);
+    }
+    REQUIRE(ptr.UseCount() == 1);
+    ptr.Reset();
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("Another thread's last release is deferred to the creator", "[threads]") {
+    Tracked::alive = 0;
+    SharedPtr<Tracked> ptr = MakeShared<Tracked>(2);
+    WeakPtr<Tracked> weak = ptr;
+    std::thread([copy = ptr]() mutable { copy.Reset(); }).join();
+    ptr.Reset();
+    // The creator's own decrement merged the counters, nothing is left to do.
+    REQUIRE(Tracked::alive == 0);
+
+    ptr = MakeShared<Tracked>(3);
+    SharedPtr<Tracked> copy = ptr;
+    ptr.Reset();
+    std::thread([copy = std::move(copy)]() mutable { copy.Reset(); }).join();
+    // The last reference was dropped by the other thread: the block waits for this one.
+    REQUIRE(Tracked::alive == 1);
+    FlushDeferredReleases();
+    REQUIRE(Tracked::alive == 0);
+    FlushDeferredReleases();
+}
+
+TEST_CASE("Blocks of an exited thread are released by whoever drops them last", "[threads]") {
+    Tracked::alive = 0;
+    SharedPtr<Outer> outer;
+    std::thread([&outer] {
+        // Both blocks are biased towards this thread, which exits with a reference counted in each.
+        SharedPtr<Outer> created = MakeShared<Outer>(Outer{MakeShared<Tracked>(4)});
+        outer = created;
+    }).join();
+    REQUIRE(outer->inner->value == 4);
+    REQUIRE(Tracked::alive == 1);
+
+    // Destroying `Outer` releases `inner`, which goes to the same ownerless record.
+    outer.Reset();
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("Objects handed to worker threads are all destroyed", "[threads]") {
+    Tracked::alive = 0;
+    constexpr int kObjects = 1000;
+    std::vector<SharedPtr<Tracked>> objects;
+    for (int i = 0; i < kObjects; ++i) {
+        objects.push_back(MakeShared<Tracked>(i));
+    }
+    std::atomic<int> mismatches = 0;
+    RunConcurrently(4, [&](int index) {
+        for (int i = index; i < kObjects; i += 4) {
+            SharedPtr<Tracked> copy = objects[i];
+            mismatches += copy->value != i;
+        }
+    });
+    std::vector<WeakPtr<Tracked>> weak(objects.begin(), objects.end());
+    RunConcurrently(4, [&](int index) {
+        for (int i = index; i < kObjects; i += 4) {
+            objects[i].Reset();
+        }
+    });
+    REQUIRE(mismatches == 0);
+    FlushDeferredReleases();
+    REQUIRE(Tracked::alive == 0);
+    for (const WeakPtr<Tracked>& ptr : weak) {
+        REQUIRE(ptr.Expired());
+    }
+}
@@ -0,0 +1,101 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/compact_shared.h"
+
+#include <stdexcept>
+
+TEST_CASE("CompactSharedPtr is one pointer wide") {
+    STATIC_REQUIRE(sizeof(CompactSharedPtr<int>) == sizeof(void*));
+    STATIC_REQUIRE(sizeof(CompactSharedPtr<const Tracked>) == sizeof(void*));
+}
+
+TEST_CASE("CompactSharedPtr counts like SharedPtr") {
+    Tracked::alive = 0;
+    {
+        CompactSharedPtr<Tracked> ptr = MakeCompactShared<Tracked>(1);
+        REQUIRE(ptr->value == 1);
+        REQUIRE(ptr.UseCount() == 1);
+
+        CompactSharedPtr<Tracked> copy = ptr;
+        SharedPtr<Tracked> shared = ptr;
+        WeakPtr<Tracked> weak = ptr;
+        REQUIRE(shared.Get() == ptr.Get());
+        REQUIRE(ptr.UseCount() == 3);
+
+        copy.Reset();
+        shared.Reset();
+        REQUIRE(ptr.UseCount() == 1);
+        ptr.Reset();
+        REQUIRE(weak.Expired());
+        REQUIRE(!ptr);
+    }
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("SharedPtr from MakeShared converts back") {
+    SharedPtr<int> shared = MakeShared<int>(2);
+    REQUIRE(CompactSharedPtr<int>::CanHold(shared));
+    CompactSharedPtr<int> compact(shared);
+    REQUIRE(compact.Get() == shared.Get());
+    REQUIRE(shared.UseCount() == 2);
+
+    CompactSharedPtr<int> moved(std::move(shared));
+    REQUIRE(!shared);
+    REQUIRE(moved.UseCount() == 2);
+
+    REQUIRE(CompactSharedPtr<int>::CanHold(SharedPtr<int>()));
+    REQUIRE(!CompactSharedPtr<int>(SharedPtr<int>()));
+}
+
+TEST_CASE("Other SharedPtrs are rejected with an exception") {
+    SharedPtr<int> plain(new int(3));
+    REQUIRE(!CompactSharedPtr<int>::CanHold(plain));
+    REQUIRE_THROWS_AS(CompactSharedPtr<int>(plain), std::invalid_argument);
+    REQUIRE_THROWS_AS(CompactSharedPtr<int>(std::move(plain)), std::invalid_argument);
+    // A rejected move leaves the source alone.
+    REQUIRE(plain.UseCount() == 1);
+
+    struct Pair {
+        int first;
+        int second;
+    };
+    SharedPtr<Pair> pair = MakeShared<Pair>(Pair{1, 2});
+    SharedPtr<int> aliased(pair, &pair->second);
+    REQUIRE_THROWS_AS(CompactSharedPtr<int>(aliased), std::invalid_argument);
+    REQUIRE(pair.UseCount() == 2);
+}
+
+TEST_CASE("CompactSharedPtr is created from a WeakPtr") {
+    SharedPtr<int> shared = MakeShared<int>(4);
+    WeakPtr<int> weak = shared;
+    CompactSharedPtr<int> compact(weak);
+    REQUIRE(*compact == 4);
+    REQUIRE(shared.UseCount() == 2);
+
+    compact.Reset();
+    shared.Reset();
+    REQUIRE_THROWS_AS(CompactSharedPtr<int>(weak), BadWeakPtr);
+
+    SharedPtr<int> plain(new int(5));
+    WeakPtr<int> plain_weak = plain;
+    REQUIRE_THROWS_AS(CompactSharedPtr<int>(plain_weak), std::invalid_argument);
+    REQUIRE(plain.UseCount() == 1);
+}
+
+TEST_CASE("CompactSharedPtr<const T> takes SharedPtr<T> and SharedPtr<const T>") {
+    SharedPtr<int> mutable_ptr = MakeShared<int>(6);
+    CompactSharedPtr<const int> from_mutable(mutable_ptr);
+    REQUIRE(from_mutable.Get() == mutable_ptr.Get());
+
+    SharedPtr<const int> const_ptr = MakeShared<const int>(7);
+    CompactSharedPtr<const int> from_const(const_ptr);
+    REQUIRE(*from_const == 7);
+
+    CompactSharedPtr<const int> made = MakeCompactShared<const int>(8);
+    SharedPtr<const int> back = made;
+    REQUIRE(*back == 8);
+    REQUIRE(made.UseCount() == 2);
+
+    STATIC_REQUIRE(!std::is_constructible_v<CompactSharedPtr<int>, const SharedPtr<const int>&>);
+}
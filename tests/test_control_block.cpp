@@ -0,0 +1,62 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/weak.h"
+
+#if defined(SW_ATOMIC_COUNTERS)
+#include "weak/atomic_shared.h"
+#endif
+
+TEST_CASE("MakeShared creates const objects") {
+    Tracked::alive = 0;
+    {
+        SharedPtr<const Tracked> ptr = MakeShared<const Tracked>(1);
+        REQUIRE(ptr->value == 1);
+        WeakPtr<const Tracked> weak = ptr;
+        SharedPtr<const Tracked> locked = weak.Lock();
+        REQUIRE(locked.Get() == ptr.Get());
+        REQUIRE(Tracked::alive == 1);
+    }
+    REQUIRE(Tracked::alive == 0);
+
+    SharedPtr<const int[]> array = MakeShared<const int[]>(3);
+    REQUIRE(array[2] == 0);
+}
+
+TEST_CASE("Control blocks without a deleter report none") {
+    SharedPtr<int> owning = MakeShared<int>(1);
+    SharedPtr<int> pointer(new int(2));
+    SharedPtr<const int> constant(new const int(3));
+    REQUIRE(owning.GetDeleter<std::default_delete<int>>() == nullptr);
+    REQUIRE(pointer.GetDeleter<std::default_delete<int>>() == nullptr);
+    REQUIRE(*constant == 3);
+}
+
+TEST_CASE("The block is freed by whichever reference goes last") {
+    Tracked::alive = 0;
+    WeakPtr<Tracked> weak;
+    {
+        SharedPtr<Tracked> ptr = MakeShared<Tracked>(4);
+        weak = ptr;
+    }
+    REQUIRE(Tracked::alive == 0);
+    REQUIRE(weak.Expired());
+    REQUIRE(!weak.Lock());
+
+    SharedPtr<Tracked> ptr(new Tracked(5));
+    {
+        WeakPtr<Tracked> other = ptr;
+    }
+    REQUIRE(ptr.UseCount() == 1);
+    ptr.Reset();
+    REQUIRE(Tracked::alive == 0);
+}
+
+#if defined(SW_ATOMIC_COUNTERS)
+TEST_CASE("AtomicSharedPtr holds const objects") {
+    SharedPtr<const int> ptr = MakeShared<const int>(6);
+    AtomicSharedPtr<const int> atomic(ptr);
+    REQUIRE(atomic.Load().Get() == ptr.Get());
+    REQUIRE(*atomic.Load() == 6);
+}
+#endif
@@ -0,0 +1,95 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/weak.h"
+
+TEST_CASE("Copies and weak references are counted") {
+    Tracked::alive = 0;
+    {
+        SharedPtr<Tracked> first = MakeShared<Tracked>(1);
+        REQUIRE(first.UseCount() == 1);
+
+        SharedPtr<Tracked> second = first;
+        WeakPtr<Tracked> weak = first;
+        REQUIRE(first.UseCount() == 2);
+        REQUIRE(weak.UseCount() == 2);
+
+        second.Reset();
+        REQUIRE(first.UseCount() == 1);
+        REQUIRE(!weak.Expired());
+
+        first.Reset();
+        REQUIRE(Tracked::alive == 0);
+        REQUIRE(weak.Expired());
+        REQUIRE(weak.UseCount() == 0);
+        REQUIRE(!weak.Lock());
+        REQUIRE_THROWS_AS(SharedPtr<Tracked>(weak), BadWeakPtr);
+    }
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("Lock takes a strong reference only while the object lives") {
+    SharedPtr<int> ptr(new int(5));
+    WeakPtr<int> weak = ptr;
+    {
+        SharedPtr<int> locked = weak.Lock();
+        REQUIRE(locked.Get() == ptr.Get());
+        REQUIRE(ptr.UseCount() == 2);
+    }
+    REQUIRE(ptr.UseCount() == 1);
+    ptr.Reset();
+    REQUIRE(!weak.Lock());
+}
+
+TEST_CASE("Copies race with each other", "[threads]") {
+    if (!RefCounts::kThreadSafe) {
+        return;
+    }
+    Tracked::alive = 0;
+    SharedPtr<Tracked> ptr = MakeShared<Tracked>(7);
+    WeakPtr<Tracked> weak = ptr;
+    std::atomic<int> mismatches = 0;
+    RunConcurrently(4, [&](int) {
+        for (int i = 0; i < 100000; ++i) {
+            SharedPtr<Tracked> copy = ptr;
+            WeakPtr<Tracked> weak_copy = weak;
+            mismatches += copy->value != 7;
+        }
+    });
+    REQUIRE(mismatches == 0);
+    REQUIRE(ptr.UseCount() == 1);
+    ptr.Reset();
+    REQUIRE(Tracked::alive == 0);
+    REQUIRE(weak.Expired());
+}
+
+TEST_CASE("Lock races with the last release", "[threads]") {
+    if (!RefCounts::kThreadSafe) {
+        return;
+    }
+    Tracked::alive = 0;
+    std::atomic<int> mismatches = 0;
+    for (int round = 0; round < 200; ++round) {
+        SharedPtr<Tracked> ptr = MakeShared<Tracked>(round);
+        WeakPtr<Tracked> weak = ptr;
+        std::atomic<bool> released = false;
+        RunConcurrently(3, [&](int index) {
+            if (index == 0) {
+                ptr.Reset();
+                released = true;
+                return;
+            }
+            while (!released) {
+                if (SharedPtr<Tracked> locked = weak.Lock()) {
+                    mismatches += locked->value != round;
+                }
+            }
+        });
+        // The object may still wait for this thread, see `FlushDeferredReleases`.
+        FlushDeferredReleases();
+        REQUIRE(weak.Expired());
+        REQUIRE(!weak.Lock());
+        REQUIRE(Tracked::alive == 0);
+    }
+    REQUIRE(mismatches == 0);
+}
@@ -0,0 +1,88 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/weak.h"
+
+#include <cstdlib>
+
+namespace {
+
+struct CountingDelete {
+    int* calls;
+
+    void operator()(Tracked* ptr) const {
+        ++*calls;
+        delete ptr;
+    }
+};
+
+struct FreeDelete {
+    void operator()(void* ptr) const {
+        std::free(ptr);
+    }
+};
+
+}  // namespace
+
+TEST_CASE("The deleter runs once, with the last strong reference") {
+    Tracked::alive = 0;
+    int calls = 0;
+    {
+        SharedPtr<Tracked> ptr(new Tracked(1), CountingDelete{&calls});
+        SharedPtr<Tracked> copy = ptr;
+        WeakPtr<Tracked> weak = ptr;
+        ptr.Reset();
+        REQUIRE(calls == 0);
+        copy.Reset();
+        REQUIRE(calls == 1);
+        REQUIRE(Tracked::alive == 0);
+    }
+    REQUIRE(calls == 1);
+}
+
+TEST_CASE("GetDeleter returns the stored deleter of the right type") {
+    int calls = 0;
+    SharedPtr<Tracked> ptr(new Tracked(2), CountingDelete{&calls});
+    CountingDelete* deleter = ptr.GetDeleter<CountingDelete>();
+    REQUIRE(deleter != nullptr);
+    REQUIRE(deleter->calls == &calls);
+    REQUIRE(ptr.GetDeleter<const CountingDelete>() == deleter);
+    REQUIRE(ptr.GetDeleter<FreeDelete>() == nullptr);
+
+    SharedPtr<Tracked> plain(new Tracked(3));
+    REQUIRE(plain.GetDeleter<CountingDelete>() == nullptr);
+    REQUIRE(SharedPtr<Tracked>().GetDeleter<CountingDelete>() == nullptr);
+
+    // Aliases keep the owner's deleter.
+    SharedPtr<int> alias(ptr, &ptr->value);
+    REQUIRE(alias.GetDeleter<CountingDelete>() == deleter);
+}
+
+TEST_CASE("Reset takes a new pointer with its deleter") {
+    Tracked::alive = 0;
+    int first = 0;
+    int second = 0;
+    SharedPtr<Tracked> ptr(new Tracked(4), CountingDelete{&first});
+    ptr.Reset(new Tracked(5), CountingDelete{&second});
+    REQUIRE(first == 1);
+    REQUIRE(ptr->value == 5);
+    ptr.Reset();
+    REQUIRE(second == 1);
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("Deleters release memory that didn't come from new") {
+    auto* raw = static_cast<int*>(std::malloc(sizeof(int)));
+    *raw = 6;
+    SharedPtr<int> ptr(raw, FreeDelete{});
+    REQUIRE(*ptr == 6);
+
+    int closed = 0;
+    {
+        SharedPtr<int> handle(new int(7), [&closed](int* value) {
+            closed = *value;
+            delete value;
+        });
+    }
+    REQUIRE(closed == 7);
+}
@@ -0,0 +1,48 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "unique/unique.h"
+#include "weak/weak.h"
+
+namespace {
+
+struct WithDefaults {
+    int value = 42;
+    std::vector<int> items{1, 2, 3};
+};
+
+}  // namespace
+
+TEST_CASE("ForOverwrite still runs default constructors") {
+    SharedPtr<WithDefaults> shared = MakeSharedForOverwrite<WithDefaults>();
+    REQUIRE(shared->value == 42);
+    REQUIRE(shared->items.size() == 3);
+
+    UniquePtr<WithDefaults> unique = MakeUniqueForOverwrite<WithDefaults>();
+    REQUIRE(unique->value == 42);
+
+    SharedPtr<WithDefaults[]> array = MakeSharedForOverwrite<WithDefaults[]>(5);
+    REQUIRE(array[4].items.size() == 3);
+}
+
+TEST_CASE("ForOverwrite arrays are writable and destroyed") {
+    Tracked::alive = 0;
+    {
+        SharedPtr<Tracked[]> shared = MakeSharedForOverwrite<Tracked[]>(7);
+        SharedPtr<Tracked[3]> fixed = MakeSharedForOverwrite<Tracked[3]>();
+        UniquePtr<Tracked[]> unique = MakeUniqueForOverwrite<Tracked[]>(4);
+        REQUIRE(Tracked::alive == 14);
+    }
+    REQUIRE(Tracked::alive == 0);
+
+    constexpr size_t kSize = 1 << 20;
+    SharedPtr<unsigned char[]> buffer = MakeSharedForOverwrite<unsigned char[]>(kSize);
+    for (size_t i = 0; i < kSize; ++i) {
+        buffer[i] = static_cast<unsigned char>(i);
+    }
+    REQUIRE(buffer[kSize - 1] == static_cast<unsigned char>(kSize - 1));
+
+    SharedPtr<double> scalar = MakeSharedForOverwrite<double>();
+    *scalar = 1.5;
+    REQUIRE(*scalar == 1.5);
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "intrusive/intrusive.h"
+#include "weak/weak.h"
+
+#include <string>
+
+namespace {
+
+struct Config : EnableSharedFromThis<Config> {
+    explicit Config(std::string name) : name(std::move(name)) {
+    }
+
+    std::string name;
+};
+
+// Static sentinels are never deleted, whatever their counter says.
+struct NoDelete {
+    template <typename T>
+    static void Destroy(T*) {
+    }
+};
+
+struct Sentinel : ThreadSafeRefCounted<Sentinel, NoDelete>, Tracked {};
+
+SharedPtr<Config> DefaultConfig() {
+    static StaticImmortal<Config> config("default");
+    return config.Share();
+}
+
+}  // namespace
+
+TEST_CASE("Immortal pointers don't count") {
+    Tracked::alive = 0;
+    // Kept reachable: the immortal block is never freed.
+    static SharedPtr<Tracked> immortal = MakeImmortal<Tracked>(1);
+    SharedPtr<Tracked> ptr = immortal;
+    {
+        SharedPtr<Tracked> copy = ptr;
+        WeakPtr<Tracked> weak = ptr;
+        REQUIRE(ptr.UseCount() == 1);
+        REQUIRE(weak.Lock().Get() == ptr.Get());
+    }
+    WeakPtr<Tracked> weak = ptr;
+    ptr.Reset();
+    // The object is never destroyed.
+    REQUIRE(Tracked::alive == 1);
+    REQUIRE(!weak.Expired());
+    REQUIRE(weak.Lock()->value == 1);
+}
+
+TEST_CASE("StaticImmortal shares an object without allocating") {
+    SharedPtr<Config> first = DefaultConfig();
+    SharedPtr<Config> second = DefaultConfig();
+    REQUIRE(first.Get() == second.Get());
+    REQUIRE(first->name == "default");
+    REQUIRE(first.UseCount() == 1);
+    REQUIRE(first->SharedFromThis().OwnerEqual(second));
+
+    Tracked::alive = 0;
+    {
+        StaticImmortal<Tracked> holder(2);
+        SharedPtr<Tracked> ptr = holder.Share();
+        REQUIRE(ptr.Get() == holder.Get());
+    }
+    // Not even the holder destroys the object.
+    REQUIRE(Tracked::alive == 1);
+}
+
+TEST_CASE("Immortal objects are shared between threads without writes", "[threads]") {
+    SharedPtr<Config> config = DefaultConfig();
+    std::atomic<int> mismatches = 0;
+    RunConcurrently(4, [&](int) {
+        for (int i = 0; i < 100000; ++i) {
+            SharedPtr<Config> copy = config;
+            mismatches += copy.Get() != config.Get();
+        }
+    });
+    REQUIRE(mismatches == 0);
+    REQUIRE(config.UseCount() == 1);
+}
+
+TEST_CASE("Immortal intrusive counters") {
+    Tracked::alive = 0;
+    static Sentinel sentinel;
+    sentinel.SetImmortal();
+    {
+        IntrusivePtr<Sentinel> ptr(&sentinel);
+        IntrusivePtr<Sentinel> copy = ptr;
+    }
+    REQUIRE(Tracked::alive == 1);
+    REQUIRE(sentinel.RefCount() == IntrusivePtr<Sentinel>(&sentinel).UseCount());
+}
@@ -0,0 +1,86 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/interner.h"
+
+#include <string>
+#include <vector>
+
+namespace {
+
+// Every value lands in the same bucket, so equality decides.
+struct CollidingHash {
+    size_t operator()(const std::string&) const {
+        return 42;
+    }
+};
+
+}  // namespace
+
+TEST_CASE("Equal values are interned once") {
+    Interner<std::string> interner;
+    SharedPtr<const std::string> first = interner.Make("schema.field");
+    SharedPtr<const std::string> second = interner.Make(std::string("schema.") + "field");
+    SharedPtr<const std::string> other = interner.Make("schema.other");
+    REQUIRE(first.Get() == second.Get());
+    REQUIRE(first.Get() != other.Get());
+    REQUIRE(*other == "schema.other");
+    REQUIRE(interner.Size() == 2);
+}
+
+TEST_CASE("Entries drop out with their last reference") {
+    Interner<std::string> interner;
+    {
+        SharedPtr<const std::string> value = interner.Make(100, 'x');
+        REQUIRE(interner.Size() == 1);
+    }
+    REQUIRE(interner.Size() == 0);
+
+    SharedPtr<const std::string> again = interner.Make(100, 'x');
+    REQUIRE(*again == std::string(100, 'x'));
+    REQUIRE(interner.Size() == 1);
+}
+
+TEST_CASE("Colliding hashes are told apart by equality") {
+    Interner<std::string, CollidingHash> interner;
+    std::vector<SharedPtr<const std::string>> values;
+    for (int i = 0; i < 50; ++i) {
+        values.push_back(interner.Make(std::to_string(i)));
+    }
+    for (int i = 0; i < 50; ++i) {
+        REQUIRE(interner.Make(std::to_string(i)).Get() == values[i].Get());
+    }
+    REQUIRE(interner.Size() == 50);
+    values.erase(values.begin(), values.begin() + 25);
+    REQUIRE(interner.Size() == 25);
+}
+
+TEST_CASE("Values may outlive the interner") {
+    SharedPtr<const std::string> survivor;
+    {
+        Interner<std::string> interner;
+        survivor = interner.Make("kept");
+    }
+    REQUIRE(*survivor == "kept");
+}
+
+TEST_CASE("Threads intern the same values", "[threads]") {
+    Interner<std::string> interner;
+    std::vector<SharedPtr<const std::string>> pinned(64);
+    for (int i = 0; i < 64; ++i) {
+        pinned[i] = interner.Make(std::to_string(i));
+    }
+    std::atomic<int> mismatches = 0;
+    RunConcurrently(4, [&](int) {
+        for (int i = 0; i < 20000; ++i) {
+            int key = i % 128;
+            SharedPtr<const std::string> value = interner.Make(std::to_string(key));
+            // The first 64 are pinned; the others come and go but are never duplicated.
+            mismatches += key < 64 && value.Get() != pinned[key].Get();
+            mismatches += *value != std::to_string(key);
+        }
+    });
+    FlushDeferredReleases();
+    REQUIRE(mismatches == 0);
+    REQUIRE(interner.Size() == 64);
+}
@@ -0,0 +1,82 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "intrusive/intrusive.h"
+
+namespace {
+
+template <typename Counter>
+struct Counted : RefCounted<Counted<Counter>, Counter, DefaultDelete>, Tracked {
+    explicit Counted(int value = 0) : Tracked(value) {
+    }
+};
+
+template <typename Counter>
+void CheckCounting() {
+    Tracked::alive = 0;
+    {
+        IntrusivePtr<Counted<Counter>> ptr = MakeIntrusive<Counted<Counter>>(1);
+        REQUIRE(ptr.UseCount() == 1);
+        IntrusivePtr<Counted<Counter>> copy = ptr;
+        REQUIRE(ptr.UseCount() == 2);
+
+        // A copy of the object starts without references.
+        Counted<Counter> value = *ptr;
+        REQUIRE(value.RefCount() == 0);
+
+        copy.Reset();
+        REQUIRE(ptr.UseCount() == 1);
+        REQUIRE(Tracked::alive == 2);
+    }
+    REQUIRE(Tracked::alive == 0);
+}
+
+}  // namespace
+
+TEST_CASE("Every counter policy counts") {
+    CheckCounting<SimpleCounter>();
+    CheckCounting<AtomicCounter>();
+    CheckCounting<Simple32Counter>();
+    CheckCounting<Atomic32Counter>();
+}
+
+TEST_CASE("32-bit counters take four bytes") {
+    STATIC_REQUIRE(sizeof(Simple32Counter) == 4);
+    STATIC_REQUIRE(sizeof(Atomic32Counter) == 4);
+    STATIC_REQUIRE(sizeof(AtomicCounter) == sizeof(size_t));
+}
+
+TEST_CASE("Atomic counters survive concurrent copies", "[threads]") {
+    Tracked::alive = 0;
+    IntrusivePtr<Counted<AtomicCounter>> ptr = MakeIntrusive<Counted<AtomicCounter>>(2);
+    IntrusivePtr<Counted<Atomic32Counter>> small = MakeIntrusive<Counted<Atomic32Counter>>(3);
+    RunConcurrently(4, [&](int) {
+        for (int i = 0; i < 100000; ++i) {
+            IntrusivePtr<Counted<AtomicCounter>> copy = ptr;
+            IntrusivePtr<Counted<Atomic32Counter>> small_copy = small;
+        }
+    });
+    REQUIRE(ptr.UseCount() == 1);
+    REQUIRE(small.UseCount() == 1);
+    ptr.Reset();
+    small.Reset();
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("Counter overflow throws instead of making the object immortal") {
+    BasicSimpleCounter<uint8_t> simple;
+    while (simple.RefCount() != 254) {
+        simple.IncRef();
+    }
+    REQUIRE_THROWS_AS(simple.IncRef(), std::overflow_error);
+    REQUIRE(simple.RefCount() == 254);
+    REQUIRE(simple.DecRef() == 253);
+
+    BasicAtomicCounter<uint8_t> atomic;
+    while (atomic.RefCount() != 127) {
+        atomic.IncRef();
+    }
+    REQUIRE_THROWS_AS(atomic.IncRef(), std::overflow_error);
+    REQUIRE(atomic.RefCount() == 127);
+    REQUIRE(atomic.DecRef() == 126);
+}
@@ -0,0 +1,118 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "intrusive/intrusive.h"
+
+namespace {
+
+struct Node : RefCountedWithWeak<Node>, Tracked {
+    explicit Node(int value = 0) : Tracked(value) {
+    }
+};
+
+}  // namespace
+
+TEST_CASE("RefCountedWithWeak takes one word") {
+    STATIC_REQUIRE(sizeof(RefCountedWithWeak<Node>) == sizeof(void*));
+}
+
+TEST_CASE("Strong references work without a side block") {
+    Tracked::alive = 0;
+    IntrusivePtr<Node> ptr = MakeIntrusive<Node>(1);
+    IntrusivePtr<Node> copy = ptr;
+    REQUIRE(ptr.UseCount() == 2);
+    copy.Reset();
+    ptr.Reset();
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("IntrusiveWeakPtr locks while the object lives") {
+    Tracked::alive = 0;
+    IntrusivePtr<Node> ptr = MakeIntrusive<Node>(2);
+    IntrusivePtr<Node> copy = ptr;
+    IntrusiveWeakPtr<Node> weak = ptr;
+    // The strong count moved to the side block.
+    REQUIRE(ptr.UseCount() == 2);
+    REQUIRE(weak.UseCount() == 2);
+
+    IntrusiveWeakPtr<Node> second = copy;
+    IntrusivePtr<Node> locked = second.Lock();
+    REQUIRE(locked.Get() == ptr.Get());
+    REQUIRE(ptr.UseCount() == 3);
+
+    locked.Reset();
+    copy.Reset();
+    ptr.Reset();
+    REQUIRE(Tracked::alive == 0);
+    REQUIRE(weak.Expired());
+    REQUIRE(!weak.Lock());
+    REQUIRE(!second.Lock());
+}
+
+TEST_CASE("Weak references outlive the object and the other way round") {
+    Tracked::alive = 0;
+    IntrusiveWeakPtr<Node> weak;
+    {
+        IntrusivePtr<Node> ptr = MakeIntrusive<Node>(3);
+        weak = ptr;
+        IntrusiveWeakPtr<Node> short_lived = weak;
+    }
+    REQUIRE(Tracked::alive == 0);
+    REQUIRE(weak.Expired());
+    weak.Reset();
+
+    IntrusivePtr<Node> ptr = MakeIntrusive<Node>(4);
+    {
+        IntrusiveWeakPtr<Node> temporary = ptr;
+    }
+    REQUIRE(ptr.UseCount() == 1);
+    ptr.Reset();
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("The first weak references race with copies", "[threads]") {
+    Tracked::alive = 0;
+    std::atomic<int> failures = 0;
+    for (int round = 0; round < 200; ++round) {
+        IntrusivePtr<Node> ptr = MakeIntrusive<Node>(round);
+        RunConcurrently(4, [&](int index) {
+            for (int i = 0; i < 200; ++i) {
+                if (index % 2 == 0) {
+                    IntrusiveWeakPtr<Node> weak = ptr;
+                    failures += !weak.Lock();
+                } else {
+                    IntrusivePtr<Node> copy = ptr;
+                    failures += copy->value != round;
+                }
+            }
+        });
+        failures += ptr.UseCount() != 1;
+    }
+    REQUIRE(failures == 0);
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("Lock races with the last release", "[threads]") {
+    Tracked::alive = 0;
+    std::atomic<int> mismatches = 0;
+    for (int round = 0; round < 200; ++round) {
+        IntrusivePtr<Node> ptr = MakeIntrusive<Node>(round);
+        IntrusiveWeakPtr<Node> weak = ptr;
+        std::atomic<bool> released = false;
+        RunConcurrently(3, [&](int index) {
+            if (index == 0) {
+                ptr.Reset();
+                released = true;
+                return;
+            }
+            while (!released) {
+                if (IntrusivePtr<Node> locked = weak.Lock()) {
+                    mismatches += locked->value != round;
+                }
+            }
+        });
+        mismatches += !weak.Expired();
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(Tracked::alive == 0);
+}
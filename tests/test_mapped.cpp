@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+
+#include "weak/mapped.h"
+#include "weak/shared_buffer.h"
+
+#include <cstdlib>
+#include <string>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+// File in the temporary directory with `size` bytes `i % 251`, removed at the end of the test.
+class TempFile {
+public:
+    explicit TempFile(size_t size) {
+        char path[] = "/tmp/test_mapped_XXXXXX";
+        int fd = mkstemp(path);
+        REQUIRE(fd >= 0);
+        std::vector<unsigned char> bytes(size);
+        for (size_t i = 0; i < size; ++i) {
+            bytes[i] = i % 251;
+        }
+        REQUIRE(write(fd, bytes.data(), size) == static_cast<ssize_t>(size));
+        close(fd);
+        path_ = path;
+    }
+
+    ~TempFile() {
+        unlink(path_.c_str());
+    }
+
+    const std::string& Path() const {
+        return path_;
+    }
+
+private:
+    std::string path_;
+};
+
+int ErrorOf(const std::string& path, size_t offset, size_t len) {
+    try {
+        MapShared(path, offset, len);
+    } catch (const std::system_error& error) {
+        return error.code().value();
+    }
+    return 0;
+}
+
+}  // namespace
+
+TEST_CASE("MapShared maps the requested bytes") {
+    const size_t page = sysconf(_SC_PAGESIZE);
+    const size_t size = 3 * page + 100;
+    TempFile file(size);
+
+    SharedPtr<const std::byte[]> whole = MapShared(file.Path(), MapAdvice::kSequential);
+    REQUIRE(static_cast<int>(whole[size - 1]) == (size - 1) % 251);
+
+    // An offset inside a page: the mapping starts at the page and skips the rest.
+    size_t offset = page + 17;
+    SharedPtr<const std::byte[]> middle =
+        MapShared(file.Path(), offset, 1000, MapAdvice::kWillNeed);
+    REQUIRE(static_cast<int>(middle[0]) == offset % 251);
+    REQUIRE(static_cast<int>(middle[999]) == (offset + 999) % 251);
+
+    SharedPtr<const std::byte[]> last = MapShared(file.Path(), size - 1, 1);
+    REQUIRE(static_cast<int>(last[0]) == (size - 1) % 251);
+}
+
+TEST_CASE("Slices keep the mapping alive") {
+    TempFile file(10000);
+    SharedSpan<const std::byte> slice;
+    {
+        SharedSpan<const std::byte> span{MapShared(file.Path(), 0, 10000), 10000};
+        slice = span.Slice(5000, 10);
+    }
+    REQUIRE(static_cast<int>(slice[3]) == 5003 % 251);
+}
+
+TEST_CASE("MapShared rejects ranges outside the file") {
+    TempFile file(4096);
+    REQUIRE(ErrorOf(file.Path(), 0, 4096) == 0);
+    REQUIRE(ErrorOf(file.Path(), 0, 0) == EINVAL);
+    REQUIRE(ErrorOf(file.Path(), 0, 4097) == EINVAL);
+    REQUIRE(ErrorOf(file.Path(), 4000, 100) == EINVAL);
+    REQUIRE(ErrorOf(file.Path(), 5000, 1) == EINVAL);
+    // `offset + len` wraps around.
+    REQUIRE(ErrorOf(file.Path(), 100, static_cast<size_t>(-50)) == EINVAL);
+    REQUIRE(ErrorOf(file.Path() + ".missing", 0, 1) == ENOENT);
+
+    TempFile empty(0);
+    REQUIRE_THROWS_AS(MapShared(empty.Path()), std::system_error);
+}
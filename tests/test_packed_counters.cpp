@@ -0,0 +1,70 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/weak.h"
+
+#include <stdexcept>
+
+namespace {
+
+constexpr size_t kMaxCount = (size_t{1} << 31) - 1;
+
+template <typename Counts>
+void CheckCounts() {
+    Counts counts;
+    REQUIRE(counts.StrongCount() == 1);
+    counts.IncStrong(2);
+    counts.IncWeak();
+    REQUIRE(counts.StrongCount() == 3);
+    REQUIRE(!counts.DecStrong(2));
+    REQUIRE(counts.IncStrongIfNonZero());
+    REQUIRE(counts.DecStrong(2));
+    REQUIRE(!counts.IncStrongIfNonZero());
+    // The weak half is untouched by the strong one.
+    REQUIRE(!counts.DecWeak());
+    REQUIRE(counts.DecWeak());
+}
+
+template <typename Counts>
+void CheckOverflow() {
+    Counts counts;
+    counts.IncStrong(kMaxCount - 1);
+    REQUIRE(counts.StrongCount() == kMaxCount);
+    REQUIRE_THROWS_AS(counts.IncStrong(), std::overflow_error);
+    REQUIRE_THROWS_AS(counts.IncStrongIfNonZero(), std::overflow_error);
+    // The failed increments are not counted.
+    REQUIRE(counts.StrongCount() == kMaxCount);
+    REQUIRE(!counts.DecStrong(kMaxCount - 1));
+    REQUIRE(counts.DecStrong());
+}
+
+}  // namespace
+
+TEST_CASE("Packed counters take one word") {
+    STATIC_REQUIRE(sizeof(PackedRefCounts) == 8);
+    STATIC_REQUIRE(sizeof(AtomicPackedRefCounts) == 8);
+}
+
+TEST_CASE("Packed counters keep strong and weak apart") {
+    CheckCounts<PackedRefCounts>();
+    CheckCounts<AtomicPackedRefCounts>();
+}
+
+TEST_CASE("Overflowing packed counters throw") {
+    CheckOverflow<PackedRefCounts>();
+    CheckOverflow<AtomicPackedRefCounts>();
+}
+
+#if defined(SW_PACKED_COUNTERS)
+TEST_CASE("Small objects fit in three words with packed counters") {
+    STATIC_REQUIRE(sizeof(ControlBlockOwning<int>) == 3 * sizeof(void*));
+
+    Tracked::alive = 0;
+    SharedPtr<Tracked> ptr = MakeShared<Tracked>(1);
+    WeakPtr<Tracked> weak = ptr;
+    REQUIRE(weak.UseCount() == 1);
+    ptr.Reset();
+    REQUIRE(Tracked::alive == 0);
+    REQUIRE(weak.Expired());
+}
+#endif
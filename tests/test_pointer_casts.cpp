@@ -0,0 +1,98 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "intrusive/intrusive.h"
+#include "weak/weak.h"
+
+namespace {
+
+struct Base {
+    virtual ~Base() = default;
+
+    int base_value = 1;
+};
+
+struct Derived : Base {
+    int derived_value = 2;
+};
+
+struct Other : Base {};
+
+struct Node : ThreadSafeRefCounted<Node>, Tracked {
+    explicit Node(int value = 0) : Tracked(value) {
+    }
+    virtual ~Node() = default;
+};
+
+struct Leaf : Node {
+    using Node::Node;
+};
+
+}  // namespace
+
+TEST_CASE("Detach and AdoptRefTag pass a reference through a raw pointer") {
+    Tracked::alive = 0;
+    IntrusivePtr<Node> ptr = MakeIntrusive<Node>(1);
+    Node* raw = ptr.Detach();
+    REQUIRE(!ptr);
+    REQUIRE(raw->RefCount() == 1);
+
+    IntrusivePtr<Node> adopted(raw, AdoptRefTag{});
+    REQUIRE(adopted.UseCount() == 1);
+    adopted.Reset();
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("SharedPtr casts share the owner") {
+    SharedPtr<Base> base = MakeShared<Derived>();
+    SharedPtr<Derived> derived = StaticPointerCast<Derived>(base);
+    REQUIRE(derived->derived_value == 2);
+    REQUIRE(derived.OwnerEqual(base));
+    REQUIRE(base.UseCount() == 2);
+
+    SharedPtr<Derived> dynamic = DynamicPointerCast<Derived>(base);
+    REQUIRE(dynamic.Get() == derived.Get());
+    REQUIRE(!DynamicPointerCast<Other>(base));
+    REQUIRE(base.UseCount() == 3);
+}
+
+TEST_CASE("Rvalue SharedPtr casts move the reference") {
+    SharedPtr<Base> base = MakeShared<Derived>();
+    SharedPtr<Base> keep = base;
+
+    SharedPtr<Derived> derived = StaticPointerCast<Derived>(std::move(base));
+    REQUIRE(!base);
+    REQUIRE(keep.UseCount() == 2);
+
+    SharedPtr<Base> again = derived;
+    SharedPtr<Other> failed = DynamicPointerCast<Other>(std::move(again));
+    REQUIRE(!failed);
+    // A failed cast leaves the source untouched.
+    REQUIRE(again.Get() == derived.Get());
+
+    SharedPtr<Derived> moved = DynamicPointerCast<Derived>(std::move(again));
+    REQUIRE(!again);
+    REQUIRE(keep.UseCount() == 3);
+}
+
+TEST_CASE("IntrusivePtr casts") {
+    Tracked::alive = 0;
+    {
+        IntrusivePtr<Node> node = MakeIntrusive<Leaf>(3);
+        IntrusivePtr<Leaf> leaf = StaticPointerCast<Leaf>(node);
+        REQUIRE(node.UseCount() == 2);
+
+        IntrusivePtr<Leaf> dynamic = DynamicPointerCast<Leaf>(std::move(node));
+        REQUIRE(!node);
+        REQUIRE(leaf.UseCount() == 2);
+
+        IntrusivePtr<Node> plain = MakeIntrusive<Node>(4);
+        REQUIRE(!DynamicPointerCast<Leaf>(std::move(plain)));
+        REQUIRE(plain.UseCount() == 1);
+
+        IntrusivePtr<Node> back = StaticPointerCast<Node>(std::move(dynamic));
+        REQUIRE(!dynamic);
+        REQUIRE(back.UseCount() == 2);
+    }
+    REQUIRE(Tracked::alive == 0);
+}
@@ -0,0 +1,103 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/pool.h"
+#include "weak/weak.h"
+
+namespace {
+
+// A size class of its own, so other tests don't move the statistics.
+struct Payload : Tracked {
+    using Tracked::Tracked;
+
+    char padding[200];
+};
+
+}  // namespace
+
+TEST_CASE("Freed chunks are reused by the same thread") {
+    Tracked::alive = 0;
+    PoolStats before = GetPoolStats<Payload>();
+    void* first = nullptr;
+    {
+        SharedPtr<Payload> ptr = MakeSharedPooled<Payload>(1);
+        REQUIRE(ptr->value == 1);
+        first = ptr.Get();
+    }
+    REQUIRE(Tracked::alive == 0);
+    SharedPtr<Payload> ptr = MakeSharedPooled<Payload>(2);
+    REQUIRE(static_cast<void*>(ptr.Get()) == first);
+
+    PoolStats after = GetPoolStats<Payload>();
+    REQUIRE(after.misses == before.misses + 1);
+    REQUIRE(after.hits == before.hits + 1);
+    REQUIRE(after.bytes_retained >= before.bytes_retained);
+    REQUIRE(after.bytes_retained % SlabPool<64>::kSlabSize == 0);
+}
+
+TEST_CASE("Weak references keep the chunk until they are gone") {
+    PoolStats before = GetPoolStats<Payload>();
+    SharedPtr<Payload> ptr = MakeSharedPooled<Payload>(3);
+    WeakPtr<Payload> weak = ptr;
+    void* chunk = ptr.Get();
+    ptr.Reset();
+    REQUIRE(weak.Expired());
+    // The chunk is still taken, so this allocation can't reuse it.
+    SharedPtr<Payload> other = MakeSharedPooled<Payload>(4);
+    REQUIRE(static_cast<void*>(other.Get()) != chunk);
+    weak.Reset();
+    SharedPtr<Payload> reused = MakeSharedPooled<Payload>(5);
+    REQUIRE(static_cast<void*>(reused.Get()) == chunk);
+    PoolStats after = GetPoolStats<Payload>();
+    REQUIRE(after.hits + after.misses == before.hits + before.misses + 3);
+}
+
+TEST_CASE("Chunks freed by other threads go back to their pool", "[threads]") {
+    if (!RefCounts::kThreadSafe) {
+        return;
+    }
+    Tracked::alive = 0;
+    constexpr int kObjects = 2000;
+    std::vector<SharedPtr<Payload>> objects;
+    for (int i = 0; i < kObjects; ++i) {
+        objects.push_back(MakeSharedPooled<Payload>(i));
+    }
+    RunConcurrently(4, [&](int index) {
+        for (int i = index; i < kObjects; i += 4) {
+            objects[i].Reset();
+        }
+    });
+    FlushDeferredReleases();
+    REQUIRE(Tracked::alive == 0);
+
+    // The remote frees are taken back in one go, so no new slab memory is needed.
+    PoolStats before = GetPoolStats<Payload>();
+    for (int i = 0; i < kObjects; ++i) {
+        objects[i] = MakeSharedPooled<Payload>(i);
+    }
+    PoolStats after = GetPoolStats<Payload>();
+    REQUIRE(after.hits - before.hits == kObjects);
+    REQUIRE(after.bytes_retained == before.bytes_retained);
+}
+
+TEST_CASE("Threads churn pooled objects", "[threads]") {
+    if (!RefCounts::kThreadSafe) {
+        return;
+    }
+    Tracked::alive = 0;
+    std::atomic<int> mismatches = 0;
+    RunConcurrently(4, [&](int index) {
+        std::vector<SharedPtr<Payload>> held;
+        for (int i = 0; i < 20000; ++i) {
+            held.push_back(MakeSharedPooled<Payload>(index));
+            if (held.size() == 64) {
+                for (const SharedPtr<Payload>& ptr : held) {
+                    mismatches += ptr->value != index;
+                }
+                held.clear();
+            }
+        }
+    });
+    REQUIRE(mismatches == 0);
+    REQUIRE(Tracked::alive == 0);
+}
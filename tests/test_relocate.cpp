@@ -0,0 +1,161 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "relocate/relocate.h"
+#include "unique/unique.h"
+#include "weak/weak.h"
+
+#include <stdexcept>
+#include <string>
+
+namespace {
+
+struct NamedDelete {
+    template <typename T>
+    void operator()(T* ptr) const {
+        delete ptr;
+    }
+
+    std::string name;
+};
+
+// Not trivially relocatable: remembers its own address.
+struct SelfAware {
+    SelfAware(int value) : value(value), self(this) {
+    }
+
+    SelfAware(SelfAware&& other) noexcept : value(other.value), self(this) {
+    }
+
+    SelfAware(const SelfAware& other) : value(other.value), self(this) {
+    }
+
+    int value;
+    SelfAware* self;
+};
+
+struct ThrowsOnCopy {
+    ThrowsOnCopy(int value) : value(value) {
+    }
+
+    ThrowsOnCopy(const ThrowsOnCopy& other) : value(other.value) {
+        if (value < 0) {
+            throw std::runtime_error("copy");
+        }
+    }
+
+    ThrowsOnCopy(ThrowsOnCopy&& other) noexcept : value(other.value) {
+    }
+
+    int value;
+};
+
+}  // namespace
+
+TEST_CASE("Smart pointers are trivially relocatable") {
+    STATIC_REQUIRE(kTriviallyRelocatable<UniquePtr<int>>);
+    STATIC_REQUIRE(kTriviallyRelocatable<UniquePtr<int[]>>);
+    STATIC_REQUIRE(kTriviallyRelocatable<SharedPtr<int>>);
+    STATIC_REQUIRE(kTriviallyRelocatable<const SharedPtr<int>>);
+    STATIC_REQUIRE(kTriviallyRelocatable<WeakPtr<int>>);
+    STATIC_REQUIRE(!kTriviallyRelocatable<UniquePtr<int, NamedDelete>>);
+    STATIC_REQUIRE(!kTriviallyRelocatable<SelfAware>);
+}
+
+TEST_CASE("RelocatingVector keeps shared pointers counted") {
+    Tracked::alive = 0;
+    {
+        SharedPtr<Tracked> first = MakeShared<Tracked>(1);
+        RelocatingVector<SharedPtr<Tracked>> vector;
+        for (int i = 0; i < 100; ++i) {
+            vector.PushBack(i % 2 ? first : MakeShared<Tracked>(i));
+        }
+        REQUIRE(vector.Size() == 100);
+        REQUIRE(first.UseCount() == 51);
+        REQUIRE(Tracked::alive == 51);
+
+        vector.Erase(0, 10);
+        REQUIRE(vector.Size() == 90);
+        REQUIRE(vector[0]->value == 10);
+        REQUIRE(vector[1].Get() == first.Get());
+        REQUIRE(first.UseCount() == 46);
+
+        vector.Erase(vector.Size() - 1);
+        vector.PopBack();
+        REQUIRE(vector.Size() == 88);
+        REQUIRE(vector[86]->value == 96);
+    }
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("RelocatingVector moves unique pointers") {
+    RelocatingVector<UniquePtr<int>> vector;
+    for (int i = 0; i < 20; ++i) {
+        vector.EmplaceBack(new int(i));
+    }
+    vector.Erase(5);
+    int sum = 0;
+    for (const UniquePtr<int>& ptr : vector) {
+        sum += *ptr;
+    }
+    REQUIRE(sum == 190 - 5);
+
+    RelocatingVector<UniquePtr<int, NamedDelete>> named;
+    for (int i = 0; i < 20; ++i) {
+        named.EmplaceBack(new int(i), NamedDelete{"deleter"});
+    }
+    named.Erase(0, 19);
+    REQUIRE(named.Size() == 1);
+    REQUIRE(*named[0] == 19);
+    REQUIRE(named[0].GetDeleter().name == "deleter");
+}
+
+TEST_CASE("RelocatingVector moves types that are not trivially relocatable") {
+    RelocatingVector<SelfAware> vector;
+    for (int i = 0; i < 33; ++i) {
+        vector.EmplaceBack(i);
+    }
+    vector.Erase(1, 3);
+    for (const SelfAware& element : vector) {
+        REQUIRE(element.self == &element);
+    }
+    REQUIRE(vector[1].value == 3);
+}
+
+TEST_CASE("Elements of the vector itself can be appended") {
+    Tracked::alive = 0;
+    {
+        RelocatingVector<SharedPtr<Tracked>> vector;
+        vector.PushBack(MakeShared<Tracked>(1));
+        for (int i = 0; i < 10; ++i) {
+            // Every other call grows the vector while the argument points into it.
+            vector.EmplaceBack(vector[0]);
+            vector.PushBack(vector[vector.Size() - 1]);
+        }
+        REQUIRE(vector.Size() == 21);
+        REQUIRE(vector[0].UseCount() == 21);
+        REQUIRE(vector[20]->value == 1);
+
+        RelocatingVector<SelfAware> aware;
+        aware.EmplaceBack(7);
+        for (int i = 0; i < 10; ++i) {
+            aware.EmplaceBack(aware[0]);
+        }
+        REQUIRE(aware[10].value == 7);
+        REQUIRE(aware[10].self == &aware[10]);
+    }
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("A throwing constructor leaves the vector unchanged") {
+    RelocatingVector<ThrowsOnCopy> vector;
+    vector.EmplaceBack(1);
+    vector.EmplaceBack(2);
+    REQUIRE(vector.Capacity() == 2);
+
+    ThrowsOnCopy bad(-1);
+    REQUIRE_THROWS_AS(vector.EmplaceBack(bad), std::runtime_error);
+    REQUIRE(vector.Size() == 2);
+    REQUIRE(vector.Capacity() == 2);
+    REQUIRE(vector[1].value == 2);
+}
@@ -0,0 +1,94 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/compact_shared.h"
+
+#include <new>
+
+namespace {
+
+// Counts its own allocations, so the tests see when the object memory is returned.
+template <size_t kSize>
+struct Counted : EnableSharedFromThis<Counted<kSize>> {
+    static inline int allocated = 0;
+
+    static void* operator new(size_t size) {
+        ++allocated;
+        return ::operator new(size);
+    }
+
+    static void operator delete(void* ptr) {
+        --allocated;
+        ::operator delete(ptr);
+    }
+
+    // Used when the object is placed inside its control block.
+    static void* operator new(size_t, void* place) {
+        return place;
+    }
+
+    Counted(int value = 0) : tracked(value) {
+    }
+
+    Tracked tracked;
+    unsigned char payload[kSize];
+};
+
+using Large = Counted<SW_SEPARATE_STORAGE_THRESHOLD>;
+using Small = Counted<16>;
+
+// Small, but weakly referenced long after it dies.
+struct Observed {
+    int value;
+};
+
+}  // namespace
+
+template <>
+struct UseSeparateStorage<Observed> : std::true_type {};
+
+TEST_CASE("Only large objects get separate storage") {
+    STATIC_REQUIRE(UseSeparateStorage<Large>::value);
+    STATIC_REQUIRE(!UseSeparateStorage<Small>::value);
+    STATIC_REQUIRE(UseSeparateStorage<Observed>::value);
+
+    Small::allocated = 0;
+    SharedPtr<Small> small = MakeShared<Small>(1);
+    // Placed inside the control block.
+    REQUIRE(Small::allocated == 0);
+    REQUIRE(CompactSharedPtr<Small>::CanHold(small));
+}
+
+TEST_CASE("Separate objects are freed while weak references remain") {
+    Tracked::alive = 0;
+    Large::allocated = 0;
+    SharedPtr<Large> ptr = MakeShared<Large>(5);
+    REQUIRE(Large::allocated == 1);
+    REQUIRE(ptr->tracked.value == 5);
+    REQUIRE(!CompactSharedPtr<Large>::CanHold(ptr));
+
+    WeakPtr<Large> weak = ptr;
+    REQUIRE(weak.Lock().Get() == ptr.Get());
+    REQUIRE(ptr->SharedFromThis().Get() == ptr.Get());
+    REQUIRE(ptr.UseCount() == 1);
+
+    ptr.Reset();
+    REQUIRE(Tracked::alive == 0);
+    REQUIRE(Large::allocated == 0);
+    REQUIRE(weak.Expired());
+    REQUIRE(!weak.Lock());
+
+    SharedPtr<Large> overwrite = MakeSharedForOverwrite<Large>();
+    REQUIRE(Large::allocated == 1);
+    overwrite.Reset();
+    REQUIRE(Large::allocated == 0);
+}
+
+TEST_CASE("UseSeparateStorage can be specialized") {
+    SharedPtr<Observed> ptr = MakeShared<Observed>(Observed{3});
+    WeakPtr<Observed> weak = ptr;
+    REQUIRE(!CompactSharedPtr<Observed>::CanHold(ptr));
+    REQUIRE(weak.Lock()->value == 3);
+    ptr.Reset();
+    REQUIRE(weak.Expired());
+}
@@ -0,0 +1,98 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "sharded/sharded_counter.h"
+#include "weak/weak.h"
+
+TEST_CASE("ShardedCounter reports the last reference") {
+    ShardedCounter<4> counter(1);
+    for (int i = 0; i < 10; ++i) {
+        counter.IncRef();
+    }
+    REQUIRE(counter.RefCount() == 11);
+    for (int i = 0; i < 10; ++i) {
+        REQUIRE(counter.DecRef() != 0);
+    }
+    REQUIRE(counter.RefCount() == 1);
+    REQUIRE(counter.TryIncRef());
+    REQUIRE(counter.DecRef(2) == 0);
+    REQUIRE(!counter.TryIncRef());
+}
+
+TEST_CASE("MakeShardedShared counts like MakeShared") {
+    Tracked::alive = 0;
+    {
+        SharedPtr<Tracked> ptr = MakeShardedShared<Tracked>(1);
+        REQUIRE(ptr->value == 1);
+        REQUIRE(ptr.UseCount() == 1);
+
+        SharedPtr<Tracked> copy = ptr;
+        WeakPtr<Tracked> weak = ptr;
+        REQUIRE(ptr.UseCount() == 2);
+        REQUIRE(weak.Lock().Get() == ptr.Get());
+
+        copy.Reset();
+        ptr.Reset();
+        REQUIRE(Tracked::alive == 0);
+        REQUIRE(weak.Expired());
+        REQUIRE(!weak.Lock());
+    }
+    REQUIRE(Tracked::alive == 0);
+
+    SharedPtr<const Tracked> constant = MakeShardedShared<const Tracked>(2);
+    REQUIRE(constant->value == 2);
+}
+
+TEST_CASE("Other blocks keep their size") {
+    STATIC_REQUIRE(sizeof(ControlBlockBase) == sizeof(void*) + sizeof(RefCounts));
+}
+
+TEST_CASE("Sharded pointers are copied from every thread", "[threads]") {
+    if (!RefCounts::kThreadSafe) {
+        return;
+    }
+    Tracked::alive = 0;
+    SharedPtr<Tracked> ptr = MakeShardedShared<Tracked>(3);
+    WeakPtr<Tracked> weak = ptr;
+    std::atomic<int> mismatches = 0;
+    RunConcurrently(8, [&](int) {
+        std::vector<SharedPtr<Tracked>> held;
+        for (int i = 0; i < 20000; ++i) {
+            held.push_back(ptr);
+            if (held.size() == 16) {
+                mismatches += held.back()->value != 3;
+                held.clear();
+            }
+        }
+    });
+    REQUIRE(mismatches == 0);
+    REQUIRE(ptr.UseCount() == 1);
+    ptr.Reset();
+    FlushDeferredReleases();
+    REQUIRE(Tracked::alive == 0);
+    REQUIRE(weak.Expired());
+}
+
+TEST_CASE("The last sharded references are dropped on several threads", "[threads]") {
+    if (!RefCounts::kThreadSafe) {
+        return;
+    }
+    Tracked::alive = 0;
+    for (int round = 0; round < 100; ++round) {
+        SharedPtr<Tracked> ptr = MakeShardedShared<Tracked>(round);
+        WeakPtr<Tracked> weak = ptr;
+        std::vector<SharedPtr<Tracked>> copies(4, ptr);
+        ptr.Reset();
+        std::atomic<int> locked = 0;
+        RunConcurrently(4, [&](int index) {
+            for (int i = 0; i < 100; ++i) {
+                locked += static_cast<bool>(weak.Lock());
+            }
+            copies[index].Reset();
+        });
+        FlushDeferredReleases();
+        REQUIRE(weak.Expired());
+        REQUIRE(locked == 400);
+    }
+    REQUIRE(Tracked::alive == 0);
+}
@@ -0,0 +1,96 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/weak.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+// Throws from the constructor once `throw_at` instances have been built.
+struct Fragile : Tracked {
+    static inline int built = 0;
+    static inline int throw_at = -1;
+
+    Fragile() : Tracked(built) {
+        if (built++ == throw_at) {
+            throw std::runtime_error("fragile");
+        }
+    }
+};
+
+struct alignas(64) Aligned {
+    char data[64];
+};
+
+}  // namespace
+
+TEST_CASE("MakeShared<T[]> value-initializes the elements") {
+    SharedPtr<int[]> array = MakeShared<int[]>(100);
+    for (int i = 0; i < 100; ++i) {
+        REQUIRE(array[i] == 0);
+        array[i] = i;
+    }
+    SharedPtr<int[]> copy = array;
+    REQUIRE(copy[99] == 99);
+    REQUIRE(copy.UseCount() == 2);
+
+    SharedPtr<int[4]> fixed = MakeShared<int[4]>();
+    REQUIRE(fixed[3] == 0);
+}
+
+TEST_CASE("Array elements are destroyed with the last reference") {
+    Tracked::alive = 0;
+    {
+        SharedPtr<Tracked[]> array = MakeShared<Tracked[]>(10);
+        WeakPtr<Tracked[]> weak = array;
+        REQUIRE(Tracked::alive == 10);
+        array.Reset();
+        REQUIRE(Tracked::alive == 0);
+        REQUIRE(weak.Expired());
+    }
+
+    SharedPtr<Tracked[]> owned(new Tracked[5]);
+    REQUIRE(Tracked::alive == 5);
+    owned.Reset();
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("A throwing element constructor destroys the built ones") {
+    Tracked::alive = 0;
+    Fragile::built = 0;
+    Fragile::throw_at = 3;
+    REQUIRE_THROWS_AS(MakeShared<Fragile[]>(10), std::runtime_error);
+    REQUIRE(Tracked::alive == 0);
+    Fragile::throw_at = -1;
+}
+
+TEST_CASE("Over-aligned elements are aligned") {
+    SharedPtr<Aligned[]> array = MakeShared<Aligned[]>(3);
+    for (int i = 0; i < 3; ++i) {
+        REQUIRE(reinterpret_cast<uintptr_t>(&array[i]) % alignof(Aligned) == 0);
+    }
+}
+
+TEST_CASE("Empty arrays are allowed") {
+    SharedPtr<int[]> array = MakeShared<int[]>(0);
+    REQUIRE(array.UseCount() == 1);
+}
+
+TEST_CASE("Sizes that overflow the block are rejected") {
+    Tracked::alive = 0;
+    // `size * sizeof(T)` alone, and together with the block header, wraps around.
+    REQUIRE_THROWS_AS(MakeShared<Aligned[]>(SIZE_MAX / 32), std::bad_array_new_length);
+    REQUIRE_THROWS_AS(MakeShared<char[]>(SIZE_MAX - 8), std::bad_array_new_length);
+    REQUIRE_THROWS_AS(MakeSharedForOverwrite<Tracked[]>(SIZE_MAX / sizeof(Tracked)),
+                      std::bad_array_new_length);
+    REQUIRE_THROWS_AS(MakeSharedForOverwrite<int[]>(SIZE_MAX / 2), std::bad_array_new_length);
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("Blocks can only be adopted by the factories") {
+    STATIC_REQUIRE(!std::is_constructible_v<SharedPtr<int>, ControlBlockBase*, int*>);
+    STATIC_REQUIRE(!std::is_constructible_v<SharedPtr<int[]>, ControlBlockBase*, int*>);
+    STATIC_REQUIRE(std::is_constructible_v<SharedPtr<int>, int*>);
+}
@@ -0,0 +1,97 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/shared_buffer.h"
+
+#include <numeric>
+
+namespace {
+
+SharedSpan<int> MakeIota(size_t size) {
+    SharedSpan<int> span = MakeSharedSpan<int>(size);
+    std::iota(span.begin(), span.end(), 0);
+    return span;
+}
+
+}  // namespace
+
+TEST_CASE("Slices share the allocation without copying") {
+    SharedSpan<int> whole = MakeIota(100);
+    SharedSpan<int> slice = whole.Slice(10, 20);
+    REQUIRE(slice.Data() == whole.Data() + 10);
+    REQUIRE(slice.Size() == 20);
+    REQUIRE(slice[0] == 10);
+
+    SharedSpan<int> tail = slice.Slice(15);
+    REQUIRE(tail.Size() == 5);
+    REQUIRE(tail[4] == 29);
+
+    auto [front, back] = whole.Split(40);
+    REQUIRE(front.Size() == 40);
+    REQUIRE(back[0] == 40);
+    REQUIRE(front.IsFollowedBy(back));
+    REQUIRE(!back.IsFollowedBy(front));
+
+    SharedSpan<const int> readonly = slice;
+    REQUIRE(readonly.Data() == slice.Data());
+}
+
+TEST_CASE("Slices keep the allocation alive") {
+    Tracked::alive = 0;
+    SharedSpan<Tracked> slice;
+    {
+        SharedSpan<Tracked> whole = MakeSharedSpan<Tracked>(8);
+        REQUIRE(Tracked::alive == 8);
+        slice = std::move(whole).Slice(2, 3);
+        REQUIRE(whole.Empty());
+    }
+    REQUIRE(Tracked::alive == 8);
+    slice = SharedSpan<Tracked>();
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("Adjacent slices merge into one segment") {
+    SharedSpan<int> first = MakeIota(64);
+    SharedSpan<int> second = MakeIota(16);
+
+    SharedSpanChain<int> chain;
+    chain.Append(first.Slice(0, 16));
+    chain.Append(first.Slice(16, 16));
+    chain.Append(SharedSpan<int>());
+    chain.Append(second);
+    chain.Append(first.Slice(48));
+    REQUIRE(chain.Size() == 64);
+    REQUIRE(chain.Segments().size() == 3);
+    REQUIRE(chain.Segments()[0].Size() == 32);
+
+    SharedSpanChain<int> middle = chain.Slice(30, 20);
+    REQUIRE(middle.Size() == 20);
+    REQUIRE(middle.Segments().size() == 3);
+    REQUIRE(middle.Segments()[0][0] == 30);
+    REQUIRE(middle.Segments()[2][1] == 49);
+
+    auto [head, rest] = chain.Split(32);
+    REQUIRE(head.Segments().size() == 1);
+    REQUIRE(rest.Segments().size() == 2);
+}
+
+TEST_CASE("A chain can be appended to itself") {
+    SharedSpan<int> data = MakeIota(10);
+    SharedSpanChain<int> chain;
+    chain.Append(data.Slice(0, 5));
+    chain.Append(MakeIota(3));
+    for (int i = 0; i < 5; ++i) {
+        chain.Append(chain);
+    }
+    REQUIRE(chain.Size() == 8 * 32);
+    REQUIRE(chain.Segments().size() == 64);
+    REQUIRE(chain.Segments()[62][4] == 4);
+    REQUIRE(chain.Segments()[63][2] == 2);
+
+    // The copy of the single segment follows a different span, so nothing is merged.
+    SharedSpanChain<int> single;
+    single.Append(data);
+    single.Append(single);
+    REQUIRE(single.Segments().size() == 2);
+    REQUIRE(single.Size() == 20);
+}
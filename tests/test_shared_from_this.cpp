@@ -0,0 +1,90 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/compact_shared.h"
+#include "weak/weak.h"
+
+namespace {
+
+struct Node : EnableSharedFromThis<Node>, Tracked {
+    explicit Node(int value = 0) : Tracked(value) {
+    }
+};
+
+struct EarlyCaller : EnableSharedFromThis<EarlyCaller> {
+    EarlyCaller() {
+        try {
+            SharedFromThis();
+        } catch (const BadWeakPtr&) {
+            threw = true;
+        }
+    }
+
+    bool threw = false;
+};
+
+}  // namespace
+
+TEST_CASE("SharedFromThis shares the owning block") {
+    Tracked::alive = 0;
+    {
+        SharedPtr<Node> ptr = MakeShared<Node>(1);
+        SharedPtr<Node> self = ptr->SharedFromThis();
+        REQUIRE(self.Get() == ptr.Get());
+        REQUIRE(self.OwnerEqual(ptr));
+        REQUIRE(ptr.UseCount() == 2);
+
+        const Node& ref = *ptr;
+        SharedPtr<const Node> const_self = ref.SharedFromThis();
+        REQUIRE(ptr.UseCount() == 3);
+
+        WeakPtr<Node> weak = ptr->WeakFromThis();
+        self.Reset();
+        const_self.Reset();
+        ptr.Reset();
+        REQUIRE(weak.Expired());
+    }
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("Every way of taking ownership wires the object") {
+    SharedPtr<Node> adopted(new Node(2));
+    REQUIRE(adopted->SharedFromThis().OwnerEqual(adopted));
+
+    SharedPtr<Node> allocated = AllocateShared<Node>(std::allocator<Node>{}, 3);
+    REQUIRE(allocated->SharedFromThis().OwnerEqual(allocated));
+
+    CompactSharedPtr<Node> compact = MakeCompactShared<Node>(4);
+    SharedPtr<Node> from_compact = compact;
+    REQUIRE(compact->SharedFromThis().OwnerEqual(from_compact));
+
+    // Kept reachable: the immortal block is never freed.
+    static SharedPtr<Node> immortal = MakeImmortal<Node>(5);
+    REQUIRE(immortal->SharedFromThis().Get() == immortal.Get());
+
+    static StaticImmortal<Node> holder(9);
+    REQUIRE(holder.Get()->SharedFromThis().Get() == holder.Get());
+
+    SharedPtr<const Node> constant = MakeShared<const Node>(6);
+    REQUIRE(constant->SharedFromThis().OwnerEqual(constant));
+}
+
+TEST_CASE("Objects without an owner throw") {
+    REQUIRE(MakeShared<EarlyCaller>()->threw);
+
+    Node local(7);
+    REQUIRE_THROWS_AS(local.SharedFromThis(), BadWeakPtr);
+    REQUIRE(local.WeakFromThis().Expired());
+
+    // A copy is a new object, it doesn't belong to the original's owner.
+    SharedPtr<Node> ptr = MakeShared<Node>(8);
+    Node copy = *ptr;
+    REQUIRE_THROWS_AS(copy.SharedFromThis(), BadWeakPtr);
+}
+
+TEST_CASE("Aliasing pointers don't take over the object") {
+    SharedPtr<Node> ptr = MakeShared<Node>(9);
+    SharedPtr<Node> other(new Node(10));
+    SharedPtr<Node> alias(other, ptr.Get());
+    REQUIRE(ptr->SharedFromThis().OwnerEqual(ptr));
+}
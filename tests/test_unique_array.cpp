@@ -0,0 +1,108 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "unique/unique.h"
+
+#include <cstdint>
+#include <stdexcept>
+
+namespace {
+
+struct alignas(32) Wide {
+    float lanes[8] = {};
+};
+
+struct ThrowsThird {
+    static inline int constructed = 0;
+
+    ThrowsThird() {
+        if (constructed == 2) {
+            throw std::runtime_error("third");
+        }
+        ++constructed;
+    }
+
+    ~ThrowsThird() {
+        --constructed;
+    }
+};
+
+template <typename T>
+bool IsAligned(const T* ptr, size_t alignment) {
+    return reinterpret_cast<uintptr_t>(ptr) % alignment == 0;
+}
+
+}  // namespace
+
+TEST_CASE("Array pointers are one word") {
+    STATIC_REQUIRE(sizeof(UniquePtr<int[]>) == sizeof(int*));
+    STATIC_REQUIRE(sizeof(UniquePtr<Tracked[]>) == sizeof(Tracked*));
+    STATIC_REQUIRE(sizeof(UniquePtr<float[], AlignedArrayDelete<float>>) == sizeof(float*));
+    STATIC_REQUIRE(sizeof(UniquePtr<Wide[], AlignedArrayDelete<Wide>>) == sizeof(Wide*));
+}
+
+TEST_CASE("Array pointers destroy every element once") {
+    Tracked::alive = 0;
+    {
+        UniquePtr<Tracked[]> first(new Tracked[5]);
+        REQUIRE(Tracked::alive == 5);
+        first[2].value = 7;
+
+        UniquePtr<Tracked[]> second = std::move(first);
+        REQUIRE(!first);
+        REQUIRE(second[2].value == 7);
+
+        first.Reset(new Tracked[2]);
+        first.Swap(second);
+        REQUIRE(first[2].value == 7);
+        REQUIRE(Tracked::alive == 7);
+
+        second = nullptr;
+        REQUIRE(Tracked::alive == 5);
+    }
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("MakeUniqueAligned aligns and value-initializes") {
+    for (size_t alignment : {1, 8, 16, 64, 4096}) {
+        auto buffer = MakeUniqueAligned<float[]>(1000, alignment);
+        REQUIRE(IsAligned(buffer.Get(), alignment));
+        for (size_t i = 0; i < 1000; ++i) {
+            REQUIRE(buffer[i] == 0.0f);
+        }
+        buffer[999] = 1.0f;
+    }
+
+    // The element type's own alignment wins over a smaller request.
+    auto wide = MakeUniqueAligned<Wide[]>(3, 8);
+    REQUIRE(IsAligned(wide.Get(), alignof(Wide)));
+
+    auto empty = MakeUniqueAligned<int[]>(0, 64);
+    REQUIRE(empty);
+}
+
+TEST_CASE("MakeUniqueAligned destroys its elements") {
+    Tracked::alive = 0;
+    {
+        auto tracked = MakeUniqueAligned<Tracked[]>(10, 64);
+        REQUIRE(Tracked::alive == 10);
+        auto moved = std::move(tracked);
+        REQUIRE(Tracked::alive == 10);
+    }
+    REQUIRE(Tracked::alive == 0);
+
+    ThrowsThird::constructed = 0;
+    REQUIRE_THROWS_AS(MakeUniqueAligned<ThrowsThird[]>(5, 64), std::runtime_error);
+    REQUIRE(ThrowsThird::constructed == 0);
+}
+
+TEST_CASE("MakeUniqueAligned rejects bad alignments and sizes") {
+    REQUIRE_THROWS_AS(MakeUniqueAligned<float[]>(4, 0), std::invalid_argument);
+    REQUIRE_THROWS_AS(MakeUniqueAligned<float[]>(4, 48), std::invalid_argument);
+
+    Tracked::alive = 0;
+    REQUIRE_THROWS_AS(MakeUniqueAligned<Tracked[]>(SIZE_MAX / sizeof(Tracked), 64),
+                      std::bad_array_new_length);
+    REQUIRE_THROWS_AS(MakeUniqueAligned<char[]>(SIZE_MAX - 8, 16), std::bad_array_new_length);
+    REQUIRE(Tracked::alive == 0);
+}
@@ -0,0 +1,114 @@
+#include <catch2/catch.hpp>
+
+#include "common.h"
+#include "weak/weak_cache.h"
+
+#include <set>
+#include <string>
+#include <unordered_set>
+
+TEST_CASE("Owner comparisons group pointers by control block") {
+    struct Pair {
+        int first;
+        int second;
+    };
+    SharedPtr<Pair> pair = MakeShared<Pair>(Pair{1, 2});
+    SharedPtr<int> second(pair, &pair->second);
+    WeakPtr<Pair> weak = pair;
+    SharedPtr<Pair> other = MakeShared<Pair>(Pair{1, 2});
+
+    REQUIRE(OwnerEqual{}(pair, second));
+    REQUIRE(OwnerEqual{}(second, weak));
+    REQUIRE(!OwnerEqual{}(pair, other));
+    REQUIRE(OwnerHash{}(pair) == OwnerHash{}(second));
+    REQUIRE(OwnerLess{}(pair, other) != OwnerLess{}(other, pair));
+
+    std::set<WeakPtr<Pair>, OwnerLess> owners{weak, WeakPtr<Pair>(other)};
+    pair.Reset();
+    second.Reset();
+    // Expired pointers keep their place.
+    REQUIRE(owners.count(weak) == 1);
+
+    std::unordered_set<WeakPtr<Pair>, OwnerHash, OwnerEqual> hashed{weak};
+    REQUIRE(hashed.count(weak) == 1);
+    REQUIRE(hashed.count(WeakPtr<Pair>(other)) == 0);
+}
+
+TEST_CASE("GetOrCreate entries go away with their values") {
+    Tracked::alive = 0;
+    WeakValueCache<std::string, Tracked> cache;
+    {
+        SharedPtr<Tracked> first = cache.GetOrCreate("a", 1);
+        SharedPtr<Tracked> again = cache.GetOrCreate("a", 2);
+        REQUIRE(again.Get() == first.Get());
+        REQUIRE(cache.TryLock("a")->value == 1);
+        REQUIRE(!cache.TryLock("b"));
+        REQUIRE(cache.Size() == 1);
+    }
+    REQUIRE(Tracked::alive == 0);
+    REQUIRE(cache.Size() == 0);
+
+    CacheStats stats = cache.GetStats();
+    REQUIRE(stats.hits == 2);
+    REQUIRE(stats.misses == 2);
+    REQUIRE(stats.evicted == 1);
+    REQUIRE(stats.expired == 0);
+}
+
+TEST_CASE("Inserted entries expire lazily") {
+    WeakValueCache<int, int> cache;
+    SharedPtr<int> value = MakeShared<int>(5);
+    cache.Insert(1, value);
+    REQUIRE(*cache.TryLock(1) == 5);
+
+    value.Reset();
+    REQUIRE(cache.Size() == 1);
+    REQUIRE(!cache.TryLock(1));
+    REQUIRE(cache.Size() == 0);
+    REQUIRE(cache.GetStats().expired == 1);
+
+    cache.Insert(2, MakeShared<int>(6));
+    cache.Erase(2);
+    REQUIRE(cache.Size() == 0);
+}
+
+TEST_CASE("A dying value doesn't evict its replacement") {
+    WeakValueCache<int, int> cache;
+    SharedPtr<int> old = cache.GetOrCreate(1, 1);
+    SharedPtr<int> replacement = MakeShared<int>(2);
+    cache.Insert(1, replacement);
+    old.Reset();
+    REQUIRE(*cache.TryLock(1) == 2);
+}
+
+TEST_CASE("Values may outlive the cache") {
+    Tracked::alive = 0;
+    SharedPtr<Tracked> survivor;
+    {
+        WeakValueCache<int, Tracked> cache;
+        survivor = cache.GetOrCreate(1, 7);
+    }
+    REQUIRE(survivor->value == 7);
+    survivor.Reset();
+    REQUIRE(Tracked::alive == 0);
+}
+
+TEST_CASE("Threads share cached values", "[threads]") {
+    Tracked::alive = 0;
+    std::atomic<int> mismatches = 0;
+    {
+        WeakValueCache<int, Tracked> cache;
+        RunConcurrently(4, [&](int) {
+            for (int i = 0; i < 20000; ++i) {
+                int key = i % 64;
+                SharedPtr<Tracked> value = cache.GetOrCreate(key, key);
+                mismatches += value->value != key;
+            }
+        });
+        FlushDeferredReleases();
+        REQUIRE(cache.Size() == 0);
+    }
+    REQUIRE(mismatches == 0);
+    REQUIRE(Tracked::alive == 0);
+}
+
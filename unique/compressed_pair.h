@@ -145,16 +145,16 @@ public:
         first_ = F();
     }
 
-    CompressedPairImp(const F& first, const S& second) : first_(first), S(second) {
+    CompressedPairImp(const F& first, const S& second) : S(second), first_(first) {
     }
 
     CompressedPairImp(F&& first, S&& second) : S(std::move(second)), first_(std::move(first)) {
     }
 
-    CompressedPairImp(const F& first, S&& second) : first_(first), S(std::move(second)) {
+    CompressedPairImp(const F& first, S&& second) : S(std::move(second)), first_(first) {
     }
 
-    CompressedPairImp(F&& first, const S& second) : first_(std::move(first)), S(second) {
+    CompressedPairImp(F&& first, const S& second) : S(second), first_(std::move(first)) {
     }
 
     CompressedPairImp(const F& first) : first_(first) {
@@ -294,7 +294,7 @@ public:
     CompressedPair(const F& first, S&& second) : Base(first, std::move(second)) {
     }
 
-    CompressedPair(F&& first, const S& second) : Base(std::move(first), second_(second)) {
+    CompressedPair(F&& first, const S& second) : Base(std::move(first), second) {
     }
 
     explicit CompressedPair(const F& first) : Base(first) {
@@ -343,7 +343,7 @@ public:
     CompressedPair(const F& first, F&& second) : Base(first, std::move(second)) {
     }
 
-    CompressedPair(F&& first, const F& second) : Base(std::move(first), second_(second)) {
+    CompressedPair(F&& first, const F& second) : Base(std::move(first), second) {
     }
 
     explicit CompressedPair(const F& first) : Base(first) {
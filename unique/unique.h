@@ -1,10 +1,16 @@
 #pragma once
 
 #include "compressed_pair.h"
+#include "../relocate/relocate.h"
 
+#include <algorithm>
+#include <cassert>
 #include <cstddef>  // std::nullptr_t
+#include <cstdint>
 #include <utility>
 #include <memory>
+#include <new>
+#include <stdexcept>
 
 template <class T>
 struct DefaultDelete {
@@ -83,13 +89,13 @@ public:
         }
     };
 
+    // Empty deleters are not touched at all.
     void Swap(UniquePtr& other) noexcept {
-        T* temp_ptr = pair_.GetFirst();
-        Deleter temp_del = std::move(pair_.GetSecond());
-        pair_.GetFirst() = other.pair_.GetFirst();
-        pair_.GetSecond() = std::move(other.pair_.GetSecond());
-        other.pair_.GetFirst() = temp_ptr;
-        other.pair_.GetSecond() = std::move(temp_del);
+        std::swap(pair_.GetFirst(), other.pair_.GetFirst());
+        if constexpr (!std::is_empty_v<Deleter>) {
+            using std::swap;
+            swap(pair_.GetSecond(), other.pair_.GetSecond());
+        }
     };
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -142,8 +148,7 @@ struct DefaultDelete<T[]> {
 };
 
 template <typename T, typename Deleter>
-class UniquePtr<T[], Deleter> : public UniquePtr<T, Deleter> {
-public:
+class UniquePtr<T[], Deleter> {
 public:
     using LRef = typename std::add_lvalue_reference_t<T>;
 
@@ -205,13 +210,13 @@ public:
         }
     };
 
+    // Empty deleters are not touched at all.
     void Swap(UniquePtr& other) noexcept {
-        T* temp_ptr = pair_.GetFirst();
-        Deleter temp_del = std::move(pair_.GetSecond());
-        pair_.GetFirst() = other.pair_.GetFirst();
-        pair_.GetSecond() = std::move(other.pair_.GetSecond());
-        other.pair_.GetFirst() = temp_ptr;
-        other.pair_.GetSecond() = std::move(temp_del);
+        std::swap(pair_.GetFirst(), other.pair_.GetFirst());
+        if constexpr (!std::is_empty_v<Deleter>) {
+            using std::swap;
+            swap(pair_.GetSecond(), other.pair_.GetSecond());
+        }
     };
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -251,3 +256,88 @@ public:
 private:
     CompressedPair<T*, Deleter> pair_;
 };
+
+static_assert(sizeof(UniquePtr<int>) == sizeof(int*));
+static_assert(sizeof(UniquePtr<int[]>) == sizeof(int*));
+
+// Deleter of `MakeUniqueAligned`. The element count and the alignment are kept in a header right
+// before the first element, so the deleter is empty and the `UniquePtr` stays one word.
+template <typename T>
+struct AlignedArrayDelete {
+    struct Header {
+        size_t size;
+        size_t alignment;
+    };
+
+    // Distance from the start of the allocation to the first element.
+    static size_t Offset(size_t alignment) {
+        return (sizeof(Header) + alignment - 1) / alignment * alignment;
+    }
+
+    void operator()(T* ptr) const {
+        const Header* header = reinterpret_cast<const Header*>(ptr) - 1;
+        size_t size = header->size;
+        size_t alignment = header->alignment;
+        for (size_t i = size; i > 0; --i) {
+            ptr[i - 1].~T();
+        }
+        ::operator delete(reinterpret_cast<char*>(ptr) - Offset(alignment),
+                          std::align_val_t{alignment});
+    }
+};
+
+// `n` value-initialized elements, the first one aligned to `alignment` (a power of two), e.g. 64
+// for SIMD kernels. Throws `std::invalid_argument` for any other alignment and
+// `std::bad_array_new_length` if the allocation would not fit in `size_t`.
+template <typename T>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0,
+                 UniquePtr<T, AlignedArrayDelete<std::remove_extent_t<T>>>>
+MakeUniqueAligned(size_t size, size_t alignment) {
+    using ElementType = std::remove_extent_t<T>;
+    using Delete = AlignedArrayDelete<ElementType>;
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        throw std::invalid_argument("alignment is not a power of two");
+    }
+    alignment = std::max({alignment, alignof(ElementType), alignof(typename Delete::Header)});
+    size_t offset = Delete::Offset(alignment);
+    if (size > (SIZE_MAX - offset) / sizeof(ElementType)) {
+        throw std::bad_array_new_length();
+    }
+    auto* memory = static_cast<char*>(
+        ::operator new(offset + size * sizeof(ElementType), std::align_val_t{alignment}));
+    auto* elements = reinterpret_cast<ElementType*>(memory + offset);
+    size_t constructed = 0;
+    try {
+        for (; constructed < size; ++constructed) {
+            new (static_cast<void*>(elements + constructed)) ElementType();
+        }
+    } catch (...) {
+        while (constructed > 0) {
+            elements[--constructed].~ElementType();
+        }
+        ::operator delete(memory, std::align_val_t{alignment});
+        throw;
+    }
+    new (reinterpret_cast<typename Delete::Header*>(elements) - 1)
+        typename Delete::Header{size, alignment};
+    return UniquePtr<T, Delete>(elements);
+}
+
+static_assert(sizeof(UniquePtr<float[], AlignedArrayDelete<float>>) == sizeof(float*));
+
+// Relocating a `UniquePtr` moves the pointer and the deleter, nothing refers back to them.
+template <typename T, typename Deleter>
+struct IsTriviallyRelocatable<UniquePtr<T, Deleter>> : IsTriviallyRelocatable<Deleter> {};
+
+// Like `UniquePtr<T>(new T())`, but the object is default-initialized: no zeroing of buffers that
+// are going to be overwritten anyway.
+template <typename T>
+std::enable_if_t<!std::is_array_v<T>, UniquePtr<T>> MakeUniqueForOverwrite() {
+    return UniquePtr<T>(new T);
+}
+
+template <typename T>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0, UniquePtr<T>>
+MakeUniqueForOverwrite(size_t size) {
+    return UniquePtr<T>(new std::remove_extent_t<T>[size]);
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <thread>
+
+// Atomically replaceable `SharedPtr`, meant for "publish a snapshot, read it everywhere" data.
+//
+// The stored control block address and a local reference counter share one 64-bit word:
+//
+//   | local counter (16 bits) | control block address (48 bits, bit 0 is the alias flag) |
+//
+// When a pointer is stored, `kReserve` strong references are added to its control block up
+// front. `Load()` takes one of them with a single `fetch_add` on the word, so readers never wait
+// for each other or for a writer. Once a reader sees that `kRefill` references were taken, it
+// moves them to the control block counter and resets the local counter to zero. Writers give the
+// unused part of the reserve back when the pointer is replaced.
+//
+// The object pointer is not stored: it is recovered from the control block. A `SharedPtr` that
+// points elsewhere (aliasing constructor, pointer to a base subobject at a non-zero offset) is
+// wrapped in a `MakeShared`-allocated holder and the word is tagged with the alias flag; loading
+// it costs two more counter updates.
+//
+// Readers that find the reserve used up wait for the refill, so the local counter stays within
+// its 16 bits unless more than 2^15 threads load at the very same moment; then the program is
+// terminated rather than miscounting.
+//
+// Requires thread-safe counters (`SW_ATOMIC_COUNTERS`) and 48-bit user-space addresses; storing a
+// pointer whose control block lies above that throws `std::length_error`.
+template <typename T>
+class AtomicSharedPtr {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    AtomicSharedPtr() = default;
+
+    AtomicSharedPtr(std::nullptr_t) : AtomicSharedPtr() {
+    }
+
+    AtomicSharedPtr(SharedPtr<T> desired) : word_(Install(std::move(desired))) {
+    }
+
+    AtomicSharedPtr(const AtomicSharedPtr&) = delete;
+    AtomicSharedPtr& operator=(const AtomicSharedPtr&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~AtomicSharedPtr() {
+        Uninstall(word_.load(std::memory_order_acquire));
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Store(SharedPtr<T> desired) {
+        Exchange(std::move(desired));
+    }
+
+    SharedPtr<T> Exchange(SharedPtr<T> desired) {
+        uint64_t old = word_.exchange(Install(std::move(desired)), std::memory_order_acq_rel);
+        return Uninstall(old);
+    }
+
+    // Replaces the stored pointer with `desired` if it equals `expected` (same object pointer and
+    // same control block). Otherwise loads the current value into `expected`.
+    bool CompareExchange(SharedPtr<T>& expected, SharedPtr<T> desired) {
+        while (true) {
+            uint64_t word = 0;
+            SharedPtr<T> current = Acquire(&word);
+            if (current.observable_obj_ != expected.observable_obj_ || current.cb_ != expected.cb_) {
+                expected = std::move(current);
+                return false;
+            }
+            uint64_t replacement = Install(desired);
+            uint64_t address = Address(word);
+            while (Address(word) == address) {
+                if (word_.compare_exchange_weak(word, replacement, std::memory_order_acq_rel,
+                                                std::memory_order_acquire)) {
+                    Uninstall(word);
+                    return true;
+                }
+            }
+            // Another writer got in between: the pointer changed, start over.
+            Uninstall(replacement);
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    SharedPtr<T> Load() const {
+        return Acquire(nullptr);
+    }
+
+    operator SharedPtr<T>() const {
+        return Load();
+    }
+
+private:
+    using Holder = ControlBlockOwning<SharedPtr<T>>;
+
+    static constexpr int kCountShift = 48;
+    static constexpr uint64_t kCountUnit = uint64_t{1} << kCountShift;
+    static constexpr uint64_t kAliasFlag = 1;
+    static constexpr uint64_t kAddressMask = (kCountUnit - 1) & ~kAliasFlag;
+
+    static constexpr size_t kReserve = size_t{1} << 15;
+    static constexpr size_t kRefill = size_t{1} << 14;
+    static constexpr size_t kMaxLocalCount = (uint64_t{1} << (64 - kCountShift)) - 1;
+
+    static_assert(kThreadSafeRefCounts<T>,
+                  "AtomicSharedPtr requires thread-safe counters (SW_ATOMIC_COUNTERS)");
+    static_assert(sizeof(void*) == sizeof(uint64_t), "AtomicSharedPtr requires 64-bit pointers");
+    static_assert(alignof(ControlBlockBase) > kAliasFlag, "the alias flag needs a free address bit");
+    // Readers stop taking references at `kReserve`, the rest of the field absorbs those that are
+    // already on the way.
+    static_assert(kRefill < kReserve && 2 * kReserve - 1 <= kMaxLocalCount);
+
+    static uint64_t Address(uint64_t word) {
+        return word & (kAddressMask | kAliasFlag);
+    }
+
+    static uint64_t Address(ControlBlockBase* cb, bool alias) {
+        return reinterpret_cast<uintptr_t>(cb) | (alias ? kAliasFlag : 0);
+    }
+
+    static size_t LocalCount(uint64_t word) {
+        return word >> kCountShift;
+    }
+
+    static bool IsAlias(uint64_t word) {
+        return word & kAliasFlag;
+    }
+
+    static ControlBlockBase* Block(uint64_t word) {
+        return reinterpret_cast<ControlBlockBase*>(word & kAddressMask);
+    }
+
+    // Turns `ptr` into a word owning its reference plus `kReserve` more.
+    static uint64_t Install(SharedPtr<T> ptr) {
+        ControlBlockBase* cb = ptr.cb_;
+        if (!cb) {
+            return 0;
+        }
+        bool alias = cb->GetObject() != static_cast<const void*>(ptr.observable_obj_);
+        if (alias) {
+            cb = new Holder(std::move(ptr));
+        }
+        if (reinterpret_cast<uintptr_t>(cb) & ~kAddressMask) {
+            if (alias) {
+                cb->DecStrongCounter();
+            }
+            throw std::length_error("AtomicSharedPtr: control block address above 48 bits");
+        }
+        if (!alias) {
+            ptr.observable_obj_ = nullptr;
+            ptr.cb_ = nullptr;
+        }
+        cb->IncStrongCounter(kReserve);
+        return Address(cb, alias);
+    }
+
+    // Gives back the references owned by a word that is no longer stored.
+    static SharedPtr<T> Uninstall(uint64_t word) {
+        ControlBlockBase* cb = Block(word);
+        if (!cb) {
+            return SharedPtr<T>{};
+        }
+        // Readers racing past the end of the reserve took references the block doesn't have yet.
+        size_t taken = LocalCount(word);
+        if (taken > kReserve) {
+            cb->IncStrongCounter(taken - kReserve);
+        }
+        size_t unused = taken < kReserve ? kReserve - taken : 0;
+        if (IsAlias(word)) {
+            SharedPtr<T> result = *static_cast<Holder*>(cb)->GetPointer();
+            cb->DecStrongCounter(unused + 1);
+            return result;
+        }
+        if (unused != 0) {
+            cb->DecStrongCounter(unused);
+        }
+        return Adopt(cb);
+    }
+
+    static SharedPtr<T> Adopt(ControlBlockBase* cb) {
+        SharedPtr<T> result;
+        result.observable_obj_ = static_cast<T*>(cb->GetObject());
+        result.cb_ = cb;
+        return result;
+    }
+
+    // Takes one reference from the reserve of the stored pointer.
+    SharedPtr<T> Acquire(uint64_t* observed) const {
+        uint64_t word = word_.load(std::memory_order_acquire);
+        // The reserve is used up: wait for the readers that took the last references to refill.
+        while (LocalCount(word) >= kReserve) {
+            std::this_thread::yield();
+            word = word_.load(std::memory_order_acquire);
+        }
+        if (Block(word)) {
+            word = word_.fetch_add(kCountUnit, std::memory_order_acquire);
+            if (LocalCount(word) == kMaxLocalCount) {
+                // The increment carried out of the word.
+                std::terminate();
+            }
+        }
+        if (observed) {
+            *observed = word;
+        }
+        ControlBlockBase* cb = Block(word);
+        if (!cb) {
+            return SharedPtr<T>{};
+        }
+        if (LocalCount(word) + 1 >= kRefill) {
+            Refill(word);
+        }
+        if (IsAlias(word)) {
+            SharedPtr<T> result = *static_cast<Holder*>(cb)->GetPointer();
+            cb->DecStrongCounter();
+            return result;
+        }
+        return Adopt(cb);
+    }
+
+    // Converts the references taken from the reserve into ordinary ones.
+    void Refill(uint64_t word) const {
+        ControlBlockBase* cb = Block(word);
+        word = word_.load(std::memory_order_relaxed);
+        while (Block(word) == cb && LocalCount(word) >= kRefill) {
+            size_t taken = LocalCount(word);
+            cb->IncStrongCounter(taken);
+            if (word_.compare_exchange_weak(word, Address(word), std::memory_order_relaxed)) {
+                return;
+            }
+            cb->DecStrongCounter(taken);
+        }
+    }
+
+    mutable std::atomic<uint64_t> word_ = 0;
+};
@@ -0,0 +1,191 @@
+#pragma once
+
+#include "weak.h"
+
+#include <stdexcept>
+#include <type_traits>
+
+// `SharedPtr` to an object created by `MakeShared`, one pointer wide.
+//
+// Such an object sits at a fixed offset inside its `ControlBlockOwning`, so only the control
+// block is stored and `Get()` is computed from it. Converts to `SharedPtr` and `WeakPtr`
+// implicitly; a `SharedPtr` (or a live `WeakPtr`) converts back if it came from `MakeShared` and
+// is not aliased, see `CanHold` (`UseSeparateStorage` types never qualify).
+template <typename T>
+class CompactSharedPtr {
+    using Block = ControlBlockOwning<std::remove_cv_t<T>>;
+
+    // Pointers to the same type that add at most `const`.
+    template <typename U>
+    using EnableIfCompatible =
+        std::enable_if_t<std::is_same_v<std::remove_cv_t<U>, std::remove_cv_t<T>> &&
+                         std::is_convertible_v<U*, T*>>;
+
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    CompactSharedPtr() : cb_(nullptr) {
+    }
+
+    CompactSharedPtr(std::nullptr_t) : CompactSharedPtr() {
+    }
+
+    // Adopts the initial reference of a block created for `MakeShared`.
+    explicit CompactSharedPtr(Block* cb) : cb_(cb) {
+    }
+
+    CompactSharedPtr(const CompactSharedPtr& other) : cb_(other.cb_) {
+        if (cb_) {
+            cb_->IncStrongCounter();
+        }
+    }
+
+    CompactSharedPtr(CompactSharedPtr&& other) : cb_(std::exchange(other.cb_, nullptr)) {
+    }
+
+    // `SharedPtr<T>` or `SharedPtr<const T>` to `CompactSharedPtr<const T>`.
+    // Throws `std::invalid_argument` unless `CanHold(other)`.
+    template <typename U, typename = EnableIfCompatible<U>>
+    explicit CompactSharedPtr(const SharedPtr<U>& other) : cb_(BlockOf(other)) {
+        if (cb_) {
+            cb_->IncStrongCounter();
+        }
+    }
+
+    // Same, `other` is left untouched if it throws.
+    template <typename U, typename = EnableIfCompatible<U>>
+    explicit CompactSharedPtr(SharedPtr<U>&& other) : cb_(BlockOf(other)) {
+        other.observable_obj_ = nullptr;
+        other.cb_ = nullptr;
+    }
+
+    // Promotes `other` like `SharedPtr(other)`: throws `BadWeakPtr` if it has expired, and
+    // `std::invalid_argument` unless `CanHold` its `SharedPtr`.
+    template <typename U, typename = EnableIfCompatible<U>>
+    explicit CompactSharedPtr(const WeakPtr<U>& other) : CompactSharedPtr(SharedPtr<U>(other)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // `operator=`-s
+
+    CompactSharedPtr& operator=(const CompactSharedPtr& other) {
+        CompactSharedPtr{other}.Swap(*this);
+        return *this;
+    }
+
+    CompactSharedPtr& operator=(CompactSharedPtr&& other) {
+        CompactSharedPtr{std::move(other)}.Swap(*this);
+        return *this;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Destructor
+
+    ~CompactSharedPtr() {
+        if (cb_) {
+            cb_->DecStrongCounter();
+        }
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Conversions
+
+    // Whether `ptr` points to an object stored inside its control block by `MakeShared<T>` (or is
+    // empty).
+    template <typename U, typename = EnableIfCompatible<U>>
+    static bool CanHold(const SharedPtr<U>& ptr) {
+        if (!ptr.cb_) {
+            return !ptr.observable_obj_;
+        }
+        Block* cb = Block::FromBase(ptr.cb_);
+        return cb && cb->GetPointer() == ptr.observable_obj_;
+    }
+
+    operator SharedPtr<T>() const& {
+        SharedPtr<T> result;
+        if (cb_) {
+            cb_->IncStrongCounter();
+            result.observable_obj_ = Get();
+            result.cb_ = cb_;
+        }
+        return result;
+    }
+
+    operator SharedPtr<T>() && {
+        SharedPtr<T> result;
+        result.observable_obj_ = Get();
+        result.cb_ = std::exchange(cb_, nullptr);
+        return result;
+    }
+
+    operator WeakPtr<T>() const {
+        WeakPtr<T> result;
+        if (cb_) {
+            cb_->IncWeakCounter();
+            result.observable_obj_ = Get();
+            result.cb_ = cb_;
+        }
+        return result;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Reset() {
+        CompactSharedPtr{}.Swap(*this);
+    }
+
+    void Swap(CompactSharedPtr& other) {
+        std::swap(cb_, other.cb_);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Get() const {
+        return cb_ ? cb_->GetPointer() : nullptr;
+    }
+
+    T& operator*() const {
+        assert(cb_ != nullptr);
+        return *cb_->GetPointer();
+    }
+
+    T* operator->() const {
+        return Get();
+    }
+
+    size_t UseCount() const {
+        if (cb_) {
+            return cb_->GetCounter();
+        }
+        return 0;
+    }
+
+    explicit operator bool() const {
+        return cb_ != nullptr;
+    }
+
+private:
+    template <typename U>
+    static Block* BlockOf(const SharedPtr<U>& ptr) {
+        if (!CanHold(ptr)) {
+            throw std::invalid_argument("CompactSharedPtr: not an object created by MakeShared");
+        }
+        return Block::FromBase(ptr.cb_);
+    }
+
+    Block* cb_;
+};
+
+template <typename T>
+struct IsTriviallyRelocatable<CompactSharedPtr<T>> : std::true_type {};
+
+// `MakeShared` returning a one-pointer handle.
+template <typename T, typename... Args>
+CompactSharedPtr<T> MakeCompactShared(Args&&... args) {
+    auto* block = new ControlBlockOwning<std::remove_cv_t<T>>(std::forward<Args>(args)...);
+    WireSharedFromThis(block, block->GetPointer());
+    return CompactSharedPtr<T>{block};
+}
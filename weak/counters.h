@@ -0,0 +1,505 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+struct ControlBlockBase;
+
+template <typename Block>
+class BiasedRefCounts;
+
+// Reference counts stored inside a control block.
+//
+// The weak counter holds one extra reference on behalf of all strong owners, so the control block
+// is released exactly once: either by the last `WeakPtr` or by the last `SharedPtr` when there are
+// no weak references left.
+//
+// Every policy provides the same interface:
+//   IncStrong(n)          add `n` strong references
+//   DecStrong(n)          drop `n` strong references, `true` if the strong counter reached zero
+//   IncStrongIfNonZero()  add a strong reference unless the object is already gone
+//   IncWeak() / DecWeak() same for the weak counter, `DecWeak` is `true` on reaching zero
+//   StrongCount()         current number of strong references
+//
+// A control block derives from the policy it uses.
+
+// Cheap non-atomic counters for single-threaded code.
+class SimpleRefCounts {
+public:
+    static constexpr bool kThreadSafe = false;
+
+    void IncStrong(size_t n = 1) noexcept {
+        str_counter_ += n;
+    }
+
+    bool DecStrong(size_t n = 1) noexcept {
+        str_counter_ -= n;
+        return str_counter_ == 0;
+    }
+
+    bool IncStrongIfNonZero() noexcept {
+        if (str_counter_ == 0) {
+            return false;
+        }
+        ++str_counter_;
+        return true;
+    }
+
+    void IncWeak() noexcept {
+        ++weak_counter_;
+    }
+
+    bool DecWeak() noexcept {
+        return --weak_counter_ == 0;
+    }
+
+    size_t StrongCount() const noexcept {
+        return str_counter_;
+    }
+
+private:
+    size_t str_counter_ = 1;
+    size_t weak_counter_ = 1;
+};
+
+// Thread-safe counters.
+// Increments are relaxed: a new reference is always created from an existing one, so the object
+// can't go away concurrently. Decrements are acquire-release, so the one that drops the last
+// reference synchronizes with all previous releases before the object (or the control block) is
+// destroyed.
+class AtomicRefCounts {
+public:
+    static constexpr bool kThreadSafe = true;
+
+    void IncStrong(size_t n = 1) noexcept {
+        str_counter_.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    bool DecStrong(size_t n = 1) noexcept {
+        return str_counter_.fetch_sub(n, std::memory_order_acq_rel) == n;
+    }
+
+    bool IncStrongIfNonZero() noexcept {
+        size_t count = str_counter_.load(std::memory_order_relaxed);
+        while (count != 0) {
+            if (str_counter_.compare_exchange_weak(count, count + 1, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void IncWeak() noexcept {
+        weak_counter_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool DecWeak() noexcept {
+        return weak_counter_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    size_t StrongCount() const noexcept {
+        return str_counter_.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<size_t> str_counter_ = 1;
+    std::atomic<size_t> weak_counter_ = 1;
+};
+
+// Both counters packed into one 64-bit word: strong in the low half, weak in the high half.
+// Counts are limited to 2^31 - 1, so an overflow is caught before it can carry into the other
+// half; overflowing increments throw `std::overflow_error`.
+class PackedRefCountsBase {
+protected:
+    static constexpr uint64_t kStrongOne = 1;
+    static constexpr uint64_t kWeakOne = uint64_t{1} << 32;
+    static constexpr uint64_t kHalfMask = kWeakOne - 1;
+    static constexpr uint64_t kMaxCount = (uint64_t{1} << 31) - 1;
+    static constexpr uint64_t kInitial = kStrongOne + kWeakOne;
+
+    static uint64_t Strong(uint64_t word) {
+        return word & kHalfMask;
+    }
+
+    static uint64_t Weak(uint64_t word) {
+        return word >> 32;
+    }
+
+    [[noreturn]] static void Overflow() {
+        throw std::overflow_error("reference counter overflow");
+    }
+};
+
+class PackedRefCounts : private PackedRefCountsBase {
+public:
+    static constexpr bool kThreadSafe = false;
+
+    void IncStrong(size_t n = 1) {
+        if (Strong(word_) + n > kMaxCount) {
+            Overflow();
+        }
+        word_ += n * kStrongOne;
+    }
+
+    bool DecStrong(size_t n = 1) noexcept {
+        word_ -= n * kStrongOne;
+        return Strong(word_) == 0;
+    }
+
+    bool IncStrongIfNonZero() {
+        if (Strong(word_) == 0) {
+            return false;
+        }
+        IncStrong();
+        return true;
+    }
+
+    void IncWeak() {
+        if (Weak(word_) + 1 > kMaxCount) {
+            Overflow();
+        }
+        word_ += kWeakOne;
+    }
+
+    bool DecWeak() noexcept {
+        word_ -= kWeakOne;
+        return Weak(word_) == 0;
+    }
+
+    size_t StrongCount() const noexcept {
+        return Strong(word_);
+    }
+
+private:
+    uint64_t word_ = kInitial;
+};
+
+// Thread-safe version of `PackedRefCounts`: every update is a single atomic operation on the word.
+// An overflowing increment is rolled back before throwing.
+class AtomicPackedRefCounts : private PackedRefCountsBase {
+public:
+    static constexpr bool kThreadSafe = true;
+
+    void IncStrong(size_t n = 1) {
+        uint64_t old = word_.fetch_add(n * kStrongOne, std::memory_order_relaxed);
+        if (Strong(old) + n > kMaxCount) {
+            word_.fetch_sub(n * kStrongOne, std::memory_order_relaxed);
+            Overflow();
+        }
+    }
+
+    bool DecStrong(size_t n = 1) noexcept {
+        return Strong(word_.fetch_sub(n * kStrongOne, std::memory_order_acq_rel)) == n;
+    }
+
+    bool IncStrongIfNonZero() {
+        uint64_t word = word_.load(std::memory_order_relaxed);
+        while (Strong(word) != 0) {
+            if (Strong(word) == kMaxCount) {
+                Overflow();
+            }
+            if (word_.compare_exchange_weak(word, word + kStrongOne, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void IncWeak() {
+        uint64_t old = word_.fetch_add(kWeakOne, std::memory_order_relaxed);
+        if (Weak(old) + 1 > kMaxCount) {
+            word_.fetch_sub(kWeakOne, std::memory_order_relaxed);
+            Overflow();
+        }
+    }
+
+    bool DecWeak() noexcept {
+        return Weak(word_.fetch_sub(kWeakOne, std::memory_order_acq_rel)) == 1;
+    }
+
+    size_t StrongCount() const noexcept {
+        return Strong(word_.load(std::memory_order_relaxed));
+    }
+
+private:
+    std::atomic<uint64_t> word_ = kInitial;
+};
+
+static_assert(sizeof(PackedRefCounts) == sizeof(uint64_t));
+static_assert(sizeof(AtomicPackedRefCounts) == sizeof(uint64_t));
+
+// Per-thread record used by `BiasedRefCounts` to recognize the owning thread and to hand it the
+// blocks it has to merge. Records are never freed: when a thread exits, its record is reused by
+// the next thread together with the ownership of all blocks still biased towards it.
+template <typename Block>
+class BiasedOwner {
+public:
+    // Record of the calling thread, `nullptr` while the thread is being torn down.
+    static BiasedOwner* Current() {
+        thread_local Holder holder;
+        return holder.owner;
+    }
+
+    // Called by other threads: `counts` have to be merged by their owner. The caller passes a weak
+    // reference that keeps the block alive until then.
+    void Enqueue(BiasedRefCounts<Block>* counts) {
+        {
+            std::lock_guard guard{mutex_};
+            if (alive_) {
+                queue_.push_back(counts);
+                pending_.store(true, std::memory_order_release);
+                return;
+            }
+            // Nobody owns the record, so nobody touches the biased counters. The merge may destroy
+            // the object and release more blocks biased towards this record, so it runs unlocked;
+            // `Acquire` waits for it before handing the record to a new thread.
+            ++merging_;
+        }
+        counts->MergeQueued();
+        std::lock_guard guard{mutex_};
+        if (--merging_ == 0) {
+            merged_.notify_all();
+        }
+    }
+
+    void Drain() {
+        if (!pending_.load(std::memory_order_acquire)) {
+            return;
+        }
+        std::vector<BiasedRefCounts<Block>*> queue;
+        {
+            std::lock_guard guard{mutex_};
+            queue.swap(queue_);
+            pending_.store(false, std::memory_order_relaxed);
+        }
+        for (BiasedRefCounts<Block>* counts : queue) {
+            counts->MergeQueued();
+        }
+    }
+
+private:
+    struct Holder {
+        Holder() : owner(Acquire()) {
+        }
+
+        ~Holder() {
+            BiasedOwner* record = std::exchange(owner, nullptr);
+            record->Release();
+        }
+
+        BiasedOwner* owner;
+    };
+
+    static BiasedOwner* Acquire() {
+        BiasedOwner* record = nullptr;
+        {
+            Registry& registry = GetRegistry();
+            std::lock_guard guard{registry.mutex};
+            if (registry.free.empty()) {
+                record = new BiasedOwner;
+            } else {
+                record = registry.free.back();
+                registry.free.pop_back();
+            }
+        }
+        std::unique_lock lock{record->mutex_};
+        record->merged_.wait(lock, [record] { return record->merging_ == 0; });
+        record->alive_ = true;
+        return record;
+    }
+
+    void Release() {
+        while (true) {
+            pending_.store(true, std::memory_order_relaxed);
+            Drain();
+            std::lock_guard guard{mutex_};
+            if (queue_.empty()) {
+                alive_ = false;
+                break;
+            }
+        }
+        Registry& registry = GetRegistry();
+        std::lock_guard guard{registry.mutex};
+        registry.free.push_back(this);
+    }
+
+    std::mutex mutex_;
+    std::vector<BiasedRefCounts<Block>*> queue_;
+    std::atomic<bool> pending_ = false;
+    bool alive_ = false;
+    // Merges run by other threads while the record has no owner.
+    size_t merging_ = 0;
+    std::condition_variable merged_;
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<BiasedOwner*> free;
+    };
+
+    // Free records for new threads. Deliberately leaked: a worker that is still running when
+    // static destructors start returns its record here on exit, and blocks may still be queued
+    // to that record for merging.
+    static Registry& GetRegistry() {
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+};
+
+// Biased counters for objects that mostly stay on the thread that created them.
+// The owning thread keeps its references in a counter that only it writes, so it needs no atomic
+// read-modify-write operations. Other threads use a separate atomic counter, which may go
+// negative when they drop references the owner counted. When the owner's counter reaches zero, it
+// is merged into the shared one and from then on every thread uses the shared counter.
+//
+// If another thread drives the shared counter negative, the owner is the only one who can tell
+// whether the object is gone, so the block is queued for it. The owner merges queued blocks on its
+// next strong decrement, on `FlushDeferredReleases()` or when it exits; until then the object
+// stays alive even though no references are left.
+//
+// `Block` must derive from the policy and provide `ReleaseStrong()` (the strong counter reached
+// zero) and `DecWeakCounter()`.
+template <typename Block>
+class BiasedRefCounts {
+public:
+    static constexpr bool kThreadSafe = true;
+
+    BiasedRefCounts() : owner_(BiasedOwner<Block>::Current()) {
+        if (owner_) {
+            biased_.store(1, std::memory_order_relaxed);
+        } else {
+            shared_.store(kMerged + kUnit, std::memory_order_relaxed);
+        }
+    }
+
+    void IncStrong(size_t n = 1) noexcept {
+        if (IsBiasedOwner()) {
+            biased_.store(biased_.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            return;
+        }
+        shared_.fetch_add(n * kUnit, std::memory_order_relaxed);
+    }
+
+    bool DecStrong(size_t n = 1) noexcept {
+        if (IsOwner()) {
+            // Merging queued blocks may merge this one too, so do it before looking at `biased_`.
+            owner_->Drain();
+        }
+        if (IsBiasedOwner()) {
+            size_t biased = biased_.load(std::memory_order_relaxed);
+            if (biased > n) {
+                biased_.store(biased - n, std::memory_order_relaxed);
+                return false;
+            }
+            // The owner lets go: move to the shared counter.
+            biased_.store(0, std::memory_order_relaxed);
+            int64_t rest = n - biased;
+            int64_t old = shared_.fetch_add(kMerged - rest * kUnit, std::memory_order_acq_rel);
+            return Count(old) == rest;
+        }
+        int64_t old = shared_.fetch_sub(n * kUnit, std::memory_order_acq_rel);
+        if (old & kMerged) {
+            return Count(old) == static_cast<int64_t>(n);
+        }
+        if (Count(old) < static_cast<int64_t>(n) && !(old & kQueued)) {
+            if (!(shared_.fetch_or(kQueued, std::memory_order_relaxed) & kQueued)) {
+                IncWeak();
+                owner_->Enqueue(this);
+            }
+        }
+        return false;
+    }
+
+    bool IncStrongIfNonZero() noexcept {
+        if (IsBiasedOwner()) {
+            IncStrong();
+            return true;
+        }
+        int64_t count = shared_.load(std::memory_order_relaxed);
+        while (!(count & kMerged) || Count(count) > 0) {
+            if (shared_.compare_exchange_weak(count, count + kUnit, std::memory_order_relaxed)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void IncWeak() noexcept {
+        weak_counter_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    bool DecWeak() noexcept {
+        return weak_counter_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+    }
+
+    size_t StrongCount() const noexcept {
+        int64_t count = biased_.load(std::memory_order_relaxed) +
+                        Count(shared_.load(std::memory_order_relaxed));
+        return count > 0 ? count : 0;
+    }
+
+private:
+    // Shared counter layout: the count in units of `kUnit`, plus two flags in the low bits.
+    static constexpr int64_t kMerged = 1;
+    static constexpr int64_t kQueued = 2;
+    static constexpr int64_t kUnit = 4;
+
+    friend BiasedOwner<Block>;
+
+    static int64_t Count(int64_t shared) {
+        return shared >> 2;
+    }
+
+    // Called on the owning thread (or under the record lock once the owner has exited).
+    void MergeQueued() {
+        size_t biased = biased_.load(std::memory_order_relaxed);
+        if (biased != 0) {
+            biased_.store(0, std::memory_order_relaxed);
+            int64_t old = shared_.fetch_add(kMerged + biased * kUnit, std::memory_order_acq_rel);
+            if (Count(old) + static_cast<int64_t>(biased) == 0) {
+                static_cast<Block*>(this)->ReleaseStrong();
+            }
+        }
+        static_cast<Block*>(this)->DecWeakCounter();
+    }
+
+    bool IsOwner() const noexcept {
+        return owner_ && owner_ == BiasedOwner<Block>::Current();
+    }
+
+    bool IsBiasedOwner() const noexcept {
+        return IsOwner() && biased_.load(std::memory_order_relaxed) != 0;
+    }
+
+    BiasedOwner<Block>* owner_;
+    std::atomic<size_t> biased_ = 0;
+    std::atomic<int64_t> shared_ = 0;
+    std::atomic<size_t> weak_counter_ = 1;
+};
+
+// Counting policy used by every control block.
+// Define `SW_ATOMIC_COUNTERS` to share `SharedPtr`/`WeakPtr` between threads, or
+// `SW_BIASED_COUNTERS` if they are shared between threads but mostly stay on one.
+// `SW_PACKED_COUNTERS` halves the counters (alone or together with `SW_ATOMIC_COUNTERS`).
+// Objects copied from every core at once can opt into per-CPU counting, see `MakeShardedShared`.
+#if defined(SW_BIASED_COUNTERS)
+using RefCounts = BiasedRefCounts<ControlBlockBase>;
+#elif defined(SW_PACKED_COUNTERS) && defined(SW_ATOMIC_COUNTERS)
+using RefCounts = AtomicPackedRefCounts;
+#elif defined(SW_PACKED_COUNTERS)
+using RefCounts = PackedRefCounts;
+#elif defined(SW_ATOMIC_COUNTERS)
+using RefCounts = AtomicRefCounts;
+#else
+using RefCounts = SimpleRefCounts;
+#endif
+
+// For the `static_assert` of a class template that hands its pointers to other threads. Depends on
+// `T`, so that including the template's header in a single-threaded build is fine.
+template <typename T>
+inline constexpr bool kThreadSafeRefCounts = RefCounts::kThreadSafe;
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "sharded_map.h"
+#include "weak.h"
+
+#include <cstddef>  // size_t
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// Hash-consing factory: at most one live `T` per equal value. `Make` returns the existing object
+// if an equal one is alive and creates it otherwise, so interned values can be compared (and
+// hashed) by pointer and equal copies don't take memory twice.
+//
+// The table holds only weak references. Each object's deleter removes its entry when the last
+// `SharedPtr` is gone, before the object is destroyed. Requires thread-safe counters
+// (`SW_ATOMIC_COUNTERS`): interned values are shared by every thread that makes an equal one.
+template <typename T, typename Hash = std::hash<T>, typename KeyEqual = std::equal_to<T>>
+class Interner {
+public:
+    Interner() : core_(MakeShared<Core>()) {
+    }
+
+    Interner(const Interner&) = delete;
+    Interner& operator=(const Interner&) = delete;
+
+    // The interned `T(args...)`. The candidate is built outside of the lock; when it is already
+    // interned, it is only a temporary.
+    template <typename... Args>
+    SharedPtr<const T> Make(Args&&... args) {
+        T value(std::forward<Args>(args)...);
+        size_t hash = Hash{}(value);
+        Shard& shard = core_->ShardFor(hash);
+        {
+            std::lock_guard guard{shard.mutex};
+            if (SharedPtr<const T> found = Find(shard, hash, value)) {
+                return found;
+            }
+        }
+        // The deleter takes the shard lock, so the pointer is created (and, if it loses the race
+        // below, released) out of the lock.
+        SharedPtr<const T> created(new T(std::move(value)), Release{WeakPtr<Core>{core_}, hash});
+        std::lock_guard guard{shard.mutex};
+        if (SharedPtr<const T> found = Find(shard, hash, *created)) {
+            return found;
+        }
+        shard.entries.emplace(hash, Entry{created});
+        return created;
+    }
+
+    // Number of interned values, including ones being destroyed right now.
+    size_t Size() const {
+        return core_->Size();
+    }
+
+private:
+    struct Entry {
+        explicit Entry(const SharedPtr<const T>& ptr) : value(ptr), object(ptr.Get()) {
+        }
+
+        WeakPtr<const T> value;
+        // Safe to read under the shard lock: the deleter erases the entry before the object goes.
+        const T* object;
+    };
+
+    using Map = ShardedMap<std::unordered_multimap<size_t, Entry>>;
+    using Shard = typename Map::Shard;
+
+    // Shared with the deleters of the values, which may outlive the interner.
+    struct Core : Map {
+        void Erase(size_t hash, const T* object) {
+            Shard& shard = this->ShardFor(hash);
+            std::lock_guard guard{shard.mutex};
+            auto [it, end] = shard.entries.equal_range(hash);
+            for (; it != end; ++it) {
+                if (it->second.object == object) {
+                    shard.entries.erase(it);
+                    return;
+                }
+            }
+        }
+    };
+
+    static_assert(kThreadSafeRefCounts<T>,
+                  "Interner requires thread-safe counters (SW_ATOMIC_COUNTERS)");
+
+    // Runs when the last strong reference to an interned value is gone.
+    struct Release {
+        WeakPtr<Core> core;
+        size_t hash;
+
+        void operator()(const T* object) {
+            if (SharedPtr<Core> locked = core.Lock()) {
+                locked->Erase(hash, object);
+            }
+            delete object;
+        }
+    };
+
+    // A live interned value equal to `value`. Entries of dying values are skipped: a newer equal
+    // value may already sit next to them.
+    static SharedPtr<const T> Find(Shard& shard, size_t hash, const T& value) {
+        auto [it, end] = shard.entries.equal_range(hash);
+        for (; it != end; ++it) {
+            if (KeyEqual{}(*it->second.object, value)) {
+                if (SharedPtr<const T> found = it->second.value.Lock()) {
+                    return found;
+                }
+            }
+        }
+        return SharedPtr<const T>();
+    }
+
+    SharedPtr<Core> core_;
+};
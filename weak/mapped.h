@@ -0,0 +1,105 @@
+#pragma once
+
+#include "shared.h"
+
+#include <cerrno>
+#include <cstddef>  // size_t, std::byte
+#include <cstdint>
+#include <string>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Access pattern hints passed to `madvise`.
+enum class MapAdvice {
+    kNone,
+    kSequential,  // read ahead aggressively, drop pages behind the reader
+    kRandom,      // no read-ahead
+    kWillNeed,    // start reading the range in now
+};
+
+// Deleter of `MapShared`: unmaps the whole region when the last reference is gone.
+struct Unmap {
+    void* base;
+    size_t length;
+
+    void operator()(const std::byte*) const {
+        munmap(base, length);
+    }
+};
+
+// Applies `advice` to the pages that cover `[data, data + len)` of a mapping.
+inline void AdviseMapped(const std::byte* data, size_t len, MapAdvice advice) {
+    int flag = MADV_NORMAL;
+    switch (advice) {
+        case MapAdvice::kNone:
+            return;
+        case MapAdvice::kSequential:
+            flag = MADV_SEQUENTIAL;
+            break;
+        case MapAdvice::kRandom:
+            flag = MADV_RANDOM;
+            break;
+        case MapAdvice::kWillNeed:
+            flag = MADV_WILLNEED;
+            break;
+    }
+    uintptr_t page = sysconf(_SC_PAGESIZE);
+    uintptr_t begin = reinterpret_cast<uintptr_t>(data) & ~(page - 1);
+    uintptr_t end = reinterpret_cast<uintptr_t>(data) + len;
+    madvise(reinterpret_cast<void*>(begin), end - begin, flag);
+}
+
+// Maps `len` bytes of the file at `path` starting at `offset` read-only and shares the mapping.
+// Readers of the same `SharedPtr` share the page cache pages instead of private heap copies.
+// Sub-views are aliasing pointers into the mapping, e.g.
+// `SharedSpan<const std::byte>{MapShared(path, 0, len), len}.Slice(...)`; the region is unmapped
+// when the last of them is gone. Throws `std::system_error` on failure, with `EINVAL` for an empty
+// range or one that does not fit in the file (touching pages past its end raises `SIGBUS`).
+inline SharedPtr<const std::byte[]> MapShared(const std::string& path, size_t offset, size_t len,
+                                              MapAdvice advice = MapAdvice::kNone) {
+    if (len == 0) {
+        throw std::system_error(EINVAL, std::generic_category(), "MapShared " + path);
+    }
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        throw std::system_error(errno, std::generic_category(), "open " + path);
+    }
+    struct stat st;
+    int error = fstat(fd, &st) != 0 ? errno : 0;
+    if (!error) {
+        size_t size = st.st_size;
+        if (offset > size || len > size - offset) {
+            error = EINVAL;
+        }
+    }
+    if (error) {
+        close(fd);
+        throw std::system_error(error, std::generic_category(), "MapShared " + path);
+    }
+    // `mmap` wants a page-aligned offset: map from the start of the page and skip the difference.
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t skip = offset % page;
+    void* base = mmap(nullptr, len + skip, PROT_READ, MAP_SHARED, fd, offset - skip);
+    error = errno;
+    close(fd);
+    if (base == MAP_FAILED) {
+        throw std::system_error(error, std::generic_category(), "mmap " + path);
+    }
+    const std::byte* data = static_cast<const std::byte*>(base) + skip;
+    AdviseMapped(data, len, advice);
+    return SharedPtr<const std::byte[]>(data, Unmap{base, len + skip});
+}
+
+// The whole file, which must not be empty.
+inline SharedPtr<const std::byte[]> MapShared(const std::string& path,
+                                              MapAdvice advice = MapAdvice::kNone) {
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) {
+        throw std::system_error(errno, std::generic_category(), "stat " + path);
+    }
+    return MapShared(path, 0, st.st_size, advice);
+}
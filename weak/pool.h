@@ -0,0 +1,240 @@
+#pragma once
+
+#include "shared.h"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+struct PoolStats {
+    size_t hits = 0;            // allocations served from a free list
+    size_t misses = 0;          // allocations carved from a slab
+    size_t bytes_retained = 0;  // slab memory held by the pools
+};
+
+// Pool of `kChunkSize`-byte chunks carved from 64 KiB slabs.
+//
+// Every thread allocates from its own pool without synchronization. A chunk freed on another
+// thread is pushed onto the lock-free remote list of the pool that owns its slab, and the owner
+// takes the whole list back in one exchange when its local free list runs dry. Slabs are aligned
+// to their size, so the owning pool is found from the chunk address.
+//
+// Pools are never destroyed: when a thread exits, its pool (with all free chunks) is handed to the
+// next thread that needs one.
+template <size_t kChunkSize>
+class SlabPool {
+public:
+    static constexpr size_t kSlabSize = size_t{1} << 16;
+    static constexpr size_t kHeaderSize = 64;
+
+    static_assert(kChunkSize % alignof(std::max_align_t) == 0);
+    static_assert(kChunkSize <= (kSlabSize - kHeaderSize) / 8, "chunk too large for a slab");
+
+    static void* Allocate() {
+        if (SlabPool* pool = Local()) {
+            return pool->AllocateChunk();
+        }
+        // The thread is exiting and has already given its pool away: borrow one.
+        Registry& registry = GetRegistry();
+        std::lock_guard guard{registry.mutex};
+        SlabPool* pool = AdoptLocked(registry);
+        void* chunk = pool->AllocateChunk();
+        registry.free.push_back(pool);
+        return chunk;
+    }
+
+    static void Deallocate(void* chunk) {
+        SlabPool* owner = SlabOf(chunk)->owner;
+        if (owner == local_) {
+            owner->PushLocal(static_cast<FreeChunk*>(chunk));
+        } else {
+            owner->PushRemote(static_cast<FreeChunk*>(chunk));
+        }
+    }
+
+    static PoolStats GetStats() {
+        PoolStats stats;
+        Registry& registry = GetRegistry();
+        std::lock_guard guard{registry.mutex};
+        for (SlabPool* pool : registry.all) {
+            stats.hits += pool->hits_.load(std::memory_order_relaxed);
+            stats.misses += pool->misses_.load(std::memory_order_relaxed);
+            stats.bytes_retained += pool->slabs_.load(std::memory_order_relaxed) * kSlabSize;
+        }
+        return stats;
+    }
+
+private:
+    struct FreeChunk {
+        FreeChunk* next;
+    };
+
+    struct SlabHeader {
+        SlabPool* owner;
+    };
+
+    struct Holder {
+        Holder() {
+            Registry& registry = GetRegistry();
+            std::lock_guard guard{registry.mutex};
+            local_ = AdoptLocked(registry);
+        }
+
+        ~Holder() {
+            Registry& registry = GetRegistry();
+            std::lock_guard guard{registry.mutex};
+            registry.free.push_back(std::exchange(local_, nullptr));
+        }
+    };
+
+    // Pool of the calling thread, `nullptr` once the thread has given it away on exit.
+    static SlabPool* Local() {
+        if (!local_ && !initialized_) {
+            initialized_ = true;
+            thread_local Holder holder;
+        }
+        return local_;
+    }
+
+    struct Registry {
+        std::mutex mutex;
+        std::vector<SlabPool*> all;
+        std::vector<SlabPool*> free;
+    };
+
+    // Every pool ever created, and the ones without a thread. Deliberately leaked: `all` is what
+    // keeps the slabs reachable, and chunks can be freed into them until the process exits.
+    static Registry& GetRegistry() {
+        static Registry* registry = new Registry;
+        return *registry;
+    }
+
+    static SlabPool* AdoptLocked(Registry& registry) {
+        if (registry.free.empty()) {
+            registry.all.push_back(new SlabPool);
+            return registry.all.back();
+        }
+        SlabPool* pool = registry.free.back();
+        registry.free.pop_back();
+        return pool;
+    }
+
+    static SlabHeader* SlabOf(void* chunk) {
+        uintptr_t address = reinterpret_cast<uintptr_t>(chunk);
+        return reinterpret_cast<SlabHeader*>(address & ~(kSlabSize - 1));
+    }
+
+    // Only the owning thread modifies the counters, so they are updated without RMW operations.
+    static void Bump(std::atomic<size_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    void* AllocateChunk() {
+        if (!local_free_) {
+            local_free_ = remote_free_.exchange(nullptr, std::memory_order_acquire);
+        }
+        if (FreeChunk* chunk = local_free_) {
+            local_free_ = chunk->next;
+            Bump(hits_);
+            return chunk;
+        }
+        Bump(misses_);
+        if (bump_ == bump_end_) {
+            NewSlab();
+        }
+        return std::exchange(bump_, bump_ + kChunkSize);
+    }
+
+    void NewSlab() {
+        char* slab = static_cast<char*>(::operator new(kSlabSize, std::align_val_t{kSlabSize}));
+        new (slab) SlabHeader{this};
+        bump_ = slab + kHeaderSize;
+        bump_end_ = bump_ + (kSlabSize - kHeaderSize) / kChunkSize * kChunkSize;
+        Bump(slabs_);
+    }
+
+    void PushLocal(FreeChunk* chunk) {
+        chunk->next = local_free_;
+        local_free_ = chunk;
+    }
+
+    void PushRemote(FreeChunk* chunk) {
+        FreeChunk* head = remote_free_.load(std::memory_order_relaxed);
+        do {
+            chunk->next = head;
+        } while (!remote_free_.compare_exchange_weak(head, chunk, std::memory_order_release,
+                                                     std::memory_order_relaxed));
+    }
+
+    FreeChunk* local_free_ = nullptr;
+    char* bump_ = nullptr;
+    char* bump_end_ = nullptr;
+    std::atomic<size_t> hits_ = 0;
+    std::atomic<size_t> misses_ = 0;
+    std::atomic<size_t> slabs_ = 0;
+    alignas(64) std::atomic<FreeChunk*> remote_free_ = nullptr;
+
+    static inline thread_local SlabPool* local_ = nullptr;
+    static inline thread_local bool initialized_ = false;
+};
+
+// Stateless allocator serving single objects from the `SlabPool` of their size class.
+// Arrays and over-aligned types go to `std::allocator`.
+template <typename T>
+class PoolAllocator {
+public:
+    using value_type = T;
+
+    static constexpr size_t kChunkSize =
+        (sizeof(T) + alignof(std::max_align_t) - 1) / alignof(std::max_align_t) *
+        alignof(std::max_align_t);
+    static constexpr bool kPooled = alignof(T) <= alignof(std::max_align_t) && kChunkSize <= 4096;
+
+    PoolAllocator() = default;
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>&) noexcept {
+    }
+
+    T* allocate(size_t n) {
+        if constexpr (kPooled) {
+            if (n == 1) {
+                return static_cast<T*>(SlabPool<kChunkSize>::Allocate());
+            }
+        }
+        return std::allocator<T>().allocate(n);
+    }
+
+    void deallocate(T* ptr, size_t n) {
+        if constexpr (kPooled) {
+            if (n == 1) {
+                SlabPool<kChunkSize>::Deallocate(ptr);
+                return;
+            }
+        }
+        std::allocator<T>().deallocate(ptr, n);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>&) const noexcept {
+        return true;
+    }
+};
+
+// `MakeShared` with the control block taken from a thread-local slab pool.
+template <typename T, typename... Args>
+SharedPtr<T> MakeSharedPooled(Args&&... args) {
+    return AllocateShared<T>(PoolAllocator<T>{}, std::forward<Args>(args)...);
+}
+
+// Statistics of the pool used by `MakeSharedPooled<T>`, summed over all threads.
+// Types with control blocks of the same size class share a pool.
+template <typename T>
+PoolStats GetPoolStats() {
+    using Block = ControlBlockOwningAlloc<T, PoolAllocator<T>>;
+    static_assert(PoolAllocator<Block>::kPooled, "T is not pooled");
+    return SlabPool<PoolAllocator<Block>::kChunkSize>::GetStats();
+}
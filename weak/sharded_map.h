@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>  // size_t
+#include <cstdint>
+#include <mutex>
+
+// `Map` split over `kShards` independently locked maps, so threads working on different keys
+// rarely wait for one another. The user hashes the key, picks the shard with `ShardFor` and holds
+// its mutex while touching `entries`.
+template <typename Map>
+class ShardedMap {
+public:
+    static constexpr size_t kShards = 16;
+
+    struct alignas(64) Shard {
+        std::mutex mutex;
+        Map entries;
+    };
+
+    Shard& ShardFor(uint64_t hash) const {
+        // The maps inside the shards use the low bits, pick the shard by the high ones.
+        return shards_[(hash * 0x9E3779B97F4A7C15ull) >> 60];
+    }
+
+    // Number of entries over all shards, each one locked in turn.
+    size_t Size() const {
+        size_t size = 0;
+        for (Shard& shard : shards_) {
+            std::lock_guard guard{shard.mutex};
+            size += shard.entries.size();
+        }
+        return size;
+    }
+
+private:
+    static_assert(kShards == 16, "ShardFor takes the top 4 bits of the hash");
+
+    mutable Shard shards_[kShards];
+};
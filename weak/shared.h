@@ -1,102 +1,560 @@
 #pragma once
 
 #include "sw_fwd.h"  // Forward declaration
+#include "counters.h"
+#include "../sharded/sharded_counter.h"
+#include "../unique/compressed_pair.h"
+#include "../relocate/relocate.h"
 
+#include <algorithm>
 #include <cstddef>  // std::nullptr_t
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <memory_resource>
+#include <new>
+#include <type_traits>
 #include <utility>
 #include <cassert>
 
-struct ControlBlockBase {
-    void IncStrongCounter() {
-        ++str_counter_;
+// Type-specific operations of a control block.
+enum class ControlBlockOp {
+    kDestroyObject,   // the last strong reference is gone
+    kDestroyBlock,    // the last weak reference is gone, free the block
+    kGetObject,       // address of the object the block was created for
+    kGetDeleterType,  // `&kTypeTag<Deleter>` of a block with a custom deleter, `nullptr` otherwise
+    kGetDeleter,      // address of the custom deleter
+};
+
+// One address per type, identifies a stored deleter without `typeid`.
+template <typename T>
+inline constexpr char kTypeTag = 0;
+
+struct ControlBlockBase;
+
+// Manager of immortal blocks, see `ControlBlockImmortal`.
+void* ManageImmortal(ControlBlockBase* cb, ControlBlockOp op);
+
+// Manager of sharded blocks and their strong counter, see `ShardedBlockBase`.
+void* ManageSharded(ControlBlockBase* cb, ControlBlockOp op);
+ShardedCounter<>& ShardedStrongCounter(const ControlBlockBase* cb);
+
+// Control blocks are not polymorphic: the counters answer `Expired()` directly and everything
+// that depends on the concrete block goes through a single `Manager` function pointer.
+struct ControlBlockBase : private RefCounts {
+    friend RefCounts;
+
+    using Manager = void* (*)(ControlBlockBase* cb, ControlBlockOp op);
+
+    explicit ControlBlockBase(Manager manager) : manager_(manager) {
+    }
+
+    void IncStrongCounter(size_t n = 1) {
+        if (IsImmortal()) {
+            return;
+        }
+        if (IsSharded()) {
+            ShardedStrongCounter(this).IncRef(n);
+            return;
+        }
+        RefCounts::IncStrong(n);
     };
 
-    void DecStrongCounter() {
-        --str_counter_;
-        if (str_counter_ == 0) {
-            OnZeroStrong();
-            if (weak_counter_ == 0) {
-                delete this;
+    void DecStrongCounter(size_t n = 1) {
+        if (IsImmortal()) {
+            return;
+        }
+        if (IsSharded()) {
+            if (ShardedStrongCounter(this).DecRef(n) != 0) {
+                return;
             }
+            // The policy counter holds a single reference for all the sharded ones.
+            n = 1;
+        }
+        if (RefCounts::DecStrong(n)) {
+            ReleaseStrong();
         }
     };
 
-    virtual void OnZeroStrong() = 0;
+    // Used to promote `WeakPtr`: fails if the object is already destroyed.
+    bool TryIncStrongCounter() {
+        if (IsSharded()) {
+            return ShardedStrongCounter(this).TryIncRef();
+        }
+        return IsImmortal() || RefCounts::IncStrongIfNonZero();
+    }
 
     void IncWeakCounter() {
-        ++weak_counter_;
+        if (IsImmortal()) {
+            return;
+        }
+        RefCounts::IncWeak();
     }
 
     void DecWeakCounter() {
-        --weak_counter_;
-        if (weak_counter_ == 0 && str_counter_ == 0) {
-            delete this;
+        if (IsImmortal()) {
+            return;
+        }
+        if (RefCounts::DecWeak()) {
+            manager_(this, ControlBlockOp::kDestroyBlock);
         }
     }
 
-    virtual bool Expired() = 0;
+    // The counters of an immortal block are never written, so the cache line holding them stays
+    // shared between all cores. `UseCount()` of such a block is always 1.
+    bool IsImmortal() const {
+        return manager_ == &ManageImmortal;
+    }
+
+    // Strong references are counted per CPU, see `MakeShardedShared`.
+    bool IsSharded() const {
+        return manager_ == &ManageSharded;
+    }
+
+    bool Expired() const {
+        return GetCounter() == 0;
+    }
+
+    void* GetObject() {
+        return manager_(this, ControlBlockOp::kGetObject);
+    }
+
+    bool IsManagedBy(Manager manager) const {
+        return manager_ == manager;
+    }
 
     size_t GetCounter() const {
-        return str_counter_;
+        if (IsSharded()) {
+            return ShardedStrongCounter(this).RefCount();
+        }
+        return RefCounts::StrongCount();
     }
 
-    virtual ~ControlBlockBase() = default;
+    // The custom deleter of the block if its type is tagged `type`, `nullptr` otherwise.
+    void* GetDeleter(const void* type) {
+        if (manager_(this, ControlBlockOp::kGetDeleterType) != type) {
+            return nullptr;
+        }
+        return manager_(this, ControlBlockOp::kGetDeleter);
+    }
 
 private:
-    size_t str_counter_ = 1;
-    size_t weak_counter_ = 0;
+    // The last strong reference is gone.
+    void ReleaseStrong() {
+        manager_(this, ControlBlockOp::kDestroyObject);
+        DecWeakCounter();
+    }
+
+    Manager manager_;
 };
 
+// With `SW_BIASED_COUNTERS`, an object whose creating thread is still alive but whose last
+// reference was dropped by another thread is destroyed by the creator: on its next strong
+// decrement, when it exits, or when it calls this. Threads that hand their objects over to others
+// and then mostly wait call it at points where they need that memory back. Does nothing under the
+// other policies.
+inline void FlushDeferredReleases() {
+#if defined(SW_BIASED_COUNTERS)
+    if (BiasedOwner<ControlBlockBase>* owner = BiasedOwner<ControlBlockBase>::Current()) {
+        owner->Drain();
+    }
+#endif
+}
+
+static_assert(sizeof(ControlBlockBase) == sizeof(void*) + sizeof(RefCounts));
+
+// Asks a control block to default-initialize the object instead of value-initializing it.
+struct ForOverwriteTag {};
+
 template <typename T>
 struct ControlBlockOwning : public ControlBlockBase {
     template <typename... Args>
-    ControlBlockOwning(Args&&... args) {
+    ControlBlockOwning(Args&&... args) : ControlBlockBase(&Manage) {
         new (static_cast<void*>(&storage_)) T(std::forward<Args>(args)...);
-        valid_ = true;
+    }
+
+    ControlBlockOwning(ForOverwriteTag) : ControlBlockBase(&Manage) {
+        new (static_cast<void*>(&storage_)) T;
     }
 
     T* GetPointer() {
-        if (valid_) {
-            return static_cast<T*>(static_cast<void*>(&storage_));
+        return static_cast<T*>(static_cast<void*>(&storage_));
+    }
+
+    // `cb` as a `ControlBlockOwning<T>` if it was created by `MakeShared<T>`, `nullptr` otherwise.
+    static ControlBlockOwning* FromBase(ControlBlockBase* cb) {
+        if (cb && cb->IsManagedBy(&Manage)) {
+            return static_cast<ControlBlockOwning*>(cb);
         }
         return nullptr;
     }
 
-    void OnZeroStrong() override {
-        if (valid_) {
-            static_cast<T*>(static_cast<void*>(&storage_))->~T();
+private:
+    static void* Manage(ControlBlockBase* cb, ControlBlockOp op) {
+        auto* self = static_cast<ControlBlockOwning*>(cb);
+        switch (op) {
+            case ControlBlockOp::kDestroyObject:
+                self->GetPointer()->~T();
+                break;
+            case ControlBlockOp::kDestroyBlock:
+                delete self;
+                break;
+            case ControlBlockOp::kGetObject:
+                return const_cast<void*>(static_cast<const void*>(self->GetPointer()));
+            case ControlBlockOp::kGetDeleterType:
+            case ControlBlockOp::kGetDeleter:
+                break;
         }
-        valid_ = false;
+        return nullptr;
+    }
+
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+};
+
+#ifdef SW_PACKED_COUNTERS
+// Manager and counters take two words, small objects fit in the third.
+static_assert(sizeof(ControlBlockOwning<int>) == 3 * sizeof(void*));
+static_assert(sizeof(ControlBlockOwning<void*>) == 3 * sizeof(void*));
+#endif
+
+// Block of an object that lives until the end of the program, see `MakeImmortal` and
+// `StaticImmortal`.
+struct ImmortalBlockBase : public ControlBlockBase {
+    explicit ImmortalBlockBase(void* object) : ControlBlockBase(&ManageImmortal), object_(object) {
+    }
+
+    void* object_;
+};
+
+inline void* ManageImmortal(ControlBlockBase* cb, ControlBlockOp op) {
+    switch (op) {
+        case ControlBlockOp::kDestroyObject:
+        case ControlBlockOp::kDestroyBlock:
+            // Unreachable: the counters of an immortal block never change.
+            break;
+        case ControlBlockOp::kGetObject:
+            return static_cast<ImmortalBlockBase*>(cb)->object_;
+        case ControlBlockOp::kGetDeleterType:
+        case ControlBlockOp::kGetDeleter:
+            break;
+    }
+    return nullptr;
+}
+
+template <typename T>
+struct ControlBlockImmortal : public ImmortalBlockBase {
+    template <typename... Args>
+    ControlBlockImmortal(Args&&... args) : ImmortalBlockBase(&storage_) {
+        new (static_cast<void*>(&storage_)) T(std::forward<Args>(args)...);
+    }
+
+    T* GetPointer() {
+        return static_cast<T*>(static_cast<void*>(&storage_));
+    }
+
+private:
+    std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
+};
+
+// Base of the blocks of `MakeShardedShared`: strong references are counted in a `ShardedCounter`,
+// which takes `kShards + 1` cache lines. The policy counter holds one strong reference on behalf
+// of all of them and drops it when the sharded count reaches zero; weak references are counted
+// as usual. Type-specific operations go to `object_manager_`.
+struct ShardedBlockBase : public ControlBlockBase {
+    explicit ShardedBlockBase(Manager object_manager)
+        : ControlBlockBase(&ManageSharded), object_manager_(object_manager) {
+    }
+
+    ShardedCounter<> strong_{1};
+    Manager object_manager_;
+};
+
+inline void* ManageSharded(ControlBlockBase* cb, ControlBlockOp op) {
+    return static_cast<ShardedBlockBase*>(cb)->object_manager_(cb, op);
+}
+
+// Kept out of line: inlined into the counter operations of every block, the (never taken) path
+// to `strong_` makes GCC warn about accesses past the end of smaller blocks.
+[[gnu::noinline]] inline ShardedCounter<>& ShardedStrongCounter(const ControlBlockBase* cb) {
+    return const_cast<ShardedBlockBase*>(static_cast<const ShardedBlockBase*>(cb))->strong_;
+}
+
+template <typename T>
+struct ControlBlockSharded : public ShardedBlockBase {
+    template <typename... Args>
+    ControlBlockSharded(Args&&... args) : ShardedBlockBase(&Manage) {
+        new (static_cast<void*>(&storage_)) T(std::forward<Args>(args)...);
     }
 
-    bool Expired() override {
-        return !valid_;
+    T* GetPointer() {
+        return static_cast<T*>(static_cast<void*>(&storage_));
     }
 
 private:
-    bool valid_;
+    static void* Manage(ControlBlockBase* cb, ControlBlockOp op) {
+        auto* self = static_cast<ControlBlockSharded*>(cb);
+        switch (op) {
+            case ControlBlockOp::kDestroyObject:
+                self->GetPointer()->~T();
+                break;
+            case ControlBlockOp::kDestroyBlock:
+                delete self;
+                break;
+            case ControlBlockOp::kGetObject:
+                return const_cast<void*>(static_cast<const void*>(self->GetPointer()));
+            case ControlBlockOp::kGetDeleterType:
+            case ControlBlockOp::kGetDeleter:
+                break;
+        }
+        return nullptr;
+    }
+
     std::aligned_storage_t<sizeof(T), alignof(T)> storage_;
 };
 
+// `T` may be an array type, then the pointer is released with `delete[]`.
 template <typename T>
 struct ControlBlockPointer : public ControlBlockBase {
-    ControlBlockPointer(T* ptr) : ptr_(ptr) {
+    using ElementType = std::remove_extent_t<T>;
+
+    ControlBlockPointer(ElementType* ptr) : ControlBlockBase(&Manage), ptr_(ptr) {
     }
 
-    void OnZeroStrong() override {
-        delete ptr_;
-        ptr_ = nullptr;
+private:
+    static void* Manage(ControlBlockBase* cb, ControlBlockOp op) {
+        auto* self = static_cast<ControlBlockPointer*>(cb);
+        switch (op) {
+            case ControlBlockOp::kDestroyObject:
+                if constexpr (std::is_array_v<T>) {
+                    delete[] self->ptr_;
+                } else {
+                    delete self->ptr_;
+                }
+                break;
+            case ControlBlockOp::kDestroyBlock:
+                delete self;
+                break;
+            case ControlBlockOp::kGetObject:
+                return const_cast<void*>(static_cast<const void*>(self->ptr_));
+            case ControlBlockOp::kGetDeleterType:
+            case ControlBlockOp::kGetDeleter:
+                break;
+        }
+        return nullptr;
     }
 
-    bool Expired() override {
-        return !ptr_;
+    ElementType* ptr_ = nullptr;
+};
+
+// Block of `MakeShared<T[]>`: the elements follow the block in the same allocation.
+template <typename T>
+struct ControlBlockArray : public ControlBlockBase {
+    // Allocates the block and value-initializes `size` elements.
+    static ControlBlockArray* Create(size_t size) {
+        return Create(size, [](void* element) { new (element) T(); });
+    }
+
+    // Same, but the elements are default-initialized.
+    static ControlBlockArray* Create(size_t size, ForOverwriteTag) {
+        if constexpr (std::is_trivially_default_constructible_v<T>) {
+            return new (Allocate(size)) ControlBlockArray(size);
+        } else {
+            return Create(size, [](void* element) { new (element) T; });
+        }
+    }
+
+    T* GetPointer() {
+        return reinterpret_cast<T*>(reinterpret_cast<char*>(this) + ElementsOffset());
     }
 
 private:
-    T* ptr_ = nullptr;
+    static constexpr size_t kAlignment = std::max(alignof(ControlBlockBase), alignof(T));
+
+    explicit ControlBlockArray(size_t size) : ControlBlockBase(&Manage), size_(size) {
+    }
+
+    template <typename Construct>
+    static ControlBlockArray* Create(size_t size, Construct construct) {
+        void* memory = Allocate(size);
+        auto* block = new (memory) ControlBlockArray(size);
+        T* elements = block->GetPointer();
+        size_t constructed = 0;
+        try {
+            for (; constructed < size; ++constructed) {
+                construct(const_cast<void*>(static_cast<const void*>(elements + constructed)));
+            }
+        } catch (...) {
+            block->DestroyElements(constructed);
+            block->~ControlBlockArray();
+            Deallocate(memory);
+            throw;
+        }
+        return block;
+    }
+
+    static constexpr size_t ElementsOffset() {
+        return (sizeof(ControlBlockArray) + alignof(T) - 1) / alignof(T) * alignof(T);
+    }
+
+    // Throws `std::bad_array_new_length` if the block would not fit in `size_t`.
+    static void* Allocate(size_t size) {
+        if (size > (SIZE_MAX - ElementsOffset()) / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        size_t bytes = ElementsOffset() + size * sizeof(T);
+        if constexpr (kAlignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            return ::operator new(bytes, std::align_val_t{kAlignment});
+        } else {
+            return ::operator new(bytes);
+        }
+    }
+
+    static void Deallocate(void* memory) {
+        if constexpr (kAlignment > __STDCPP_DEFAULT_NEW_ALIGNMENT__) {
+            ::operator delete(memory, std::align_val_t{kAlignment});
+        } else {
+            ::operator delete(memory);
+        }
+    }
+
+    // Destroys the first `count` elements in reverse order.
+    void DestroyElements(size_t count) {
+        T* elements = GetPointer();
+        while (count > 0) {
+            elements[--count].~T();
+        }
+    }
+
+    static void* Manage(ControlBlockBase* cb, ControlBlockOp op) {
+        auto* self = static_cast<ControlBlockArray*>(cb);
+        switch (op) {
+            case ControlBlockOp::kDestroyObject:
+                self->DestroyElements(self->size_);
+                break;
+            case ControlBlockOp::kDestroyBlock:
+                self->~ControlBlockArray();
+                Deallocate(self);
+                break;
+            case ControlBlockOp::kGetObject:
+                return const_cast<void*>(static_cast<const void*>(self->GetPointer()));
+            case ControlBlockOp::kGetDeleterType:
+            case ControlBlockOp::kGetDeleter:
+                break;
+        }
+        return nullptr;
+    }
+
+    size_t size_;
+};
+
+// Allocates `Block` through `alloc` rebound to it.
+template <typename Block, typename Alloc, typename... Args>
+Block* AllocateControlBlock(const Alloc& alloc, Args&&... args) {
+    using BlockAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Block>;
+    using Traits = std::allocator_traits<BlockAlloc>;
+    BlockAlloc block_alloc(alloc);
+    Block* block = Traits::allocate(block_alloc, 1);
+    try {
+        return new (static_cast<void*>(block)) Block(std::forward<Args>(args)...);
+    } catch (...) {
+        Traits::deallocate(block_alloc, block, 1);
+        throw;
+    }
+}
+
+// Destroys `block` allocated by `AllocateControlBlock` with a copy of `alloc`.
+template <typename Block, typename Alloc>
+void DeallocateControlBlock(Block* block, const Alloc& alloc) {
+    using BlockAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<Block>;
+    BlockAlloc block_alloc(alloc);
+    block->~Block();
+    std::allocator_traits<BlockAlloc>::deallocate(block_alloc, block, 1);
+}
+
+// Same as `ControlBlockOwning`, but the block lives in memory obtained from `Alloc`.
+// Empty allocators take no space.
+template <typename T, typename Alloc>
+struct ControlBlockOwningAlloc : public ControlBlockBase {
+    using ObjectAlloc = typename std::allocator_traits<Alloc>::template rebind_alloc<T>;
+
+    template <typename... Args>
+    ControlBlockOwningAlloc(const Alloc& alloc, Args&&... args)
+        : ControlBlockBase(&Manage), pair_(ObjectAlloc(alloc)) {
+        std::allocator_traits<ObjectAlloc>::construct(pair_.GetFirst(), GetPointer(),
+                                                      std::forward<Args>(args)...);
+    }
+
+    T* GetPointer() {
+        return static_cast<T*>(static_cast<void*>(&pair_.GetSecond()));
+    }
+
+private:
+    static void* Manage(ControlBlockBase* cb, ControlBlockOp op) {
+        auto* self = static_cast<ControlBlockOwningAlloc*>(cb);
+        switch (op) {
+            case ControlBlockOp::kDestroyObject:
+                std::allocator_traits<ObjectAlloc>::destroy(self->pair_.GetFirst(),
+                                                            self->GetPointer());
+                break;
+            case ControlBlockOp::kDestroyBlock: {
+                ObjectAlloc alloc = self->pair_.GetFirst();
+                DeallocateControlBlock(self, alloc);
+                break;
+            }
+            case ControlBlockOp::kGetObject:
+                return const_cast<void*>(static_cast<const void*>(self->GetPointer()));
+            case ControlBlockOp::kGetDeleterType:
+            case ControlBlockOp::kGetDeleter:
+                break;
+        }
+        return nullptr;
+    }
+
+    CompressedPair<ObjectAlloc, std::aligned_storage_t<sizeof(T), alignof(T)>> pair_;
 };
 
+// Owns a pointer released by `Deleter`, the block itself is allocated through `Alloc`.
+// Stateless deleters and allocators take no space.
+template <typename T, typename Deleter, typename Alloc>
+struct ControlBlockDeleter : public ControlBlockBase {
+    ControlBlockDeleter(T* ptr, Deleter deleter, const Alloc& alloc)
+        : ControlBlockBase(&Manage),
+          pair_(ptr, CompressedPair<Deleter, Alloc>(std::move(deleter), alloc)) {
+    }
+
+private:
+    static void* Manage(ControlBlockBase* cb, ControlBlockOp op) {
+        auto* self = static_cast<ControlBlockDeleter*>(cb);
+        switch (op) {
+            case ControlBlockOp::kDestroyObject:
+                self->pair_.GetSecond().GetFirst()(self->pair_.GetFirst());
+                break;
+            case ControlBlockOp::kDestroyBlock: {
+                Alloc alloc = self->pair_.GetSecond().GetSecond();
+                DeallocateControlBlock(self, alloc);
+                break;
+            }
+            case ControlBlockOp::kGetObject:
+                return const_cast<void*>(static_cast<const void*>(self->pair_.GetFirst()));
+            case ControlBlockOp::kGetDeleterType:
+                return const_cast<char*>(&kTypeTag<Deleter>);
+            case ControlBlockOp::kGetDeleter:
+                return &self->pair_.GetSecond().GetFirst();
+        }
+        return nullptr;
+    }
+
+    CompressedPair<T*, CompressedPair<Deleter, Alloc>> pair_;
+};
+
+// Points the weak reference embedded in an `EnableSharedFromThis` object at `cb`, the block that
+// has just taken ownership of it. Does nothing for other types.
+template <typename Y>
+void WireSharedFromThis(ControlBlockBase* cb, const EnableSharedFromThis<Y>* ptr);
+
+inline void WireSharedFromThis(ControlBlockBase*, const volatile void*) {
+}
+
 // https://en.cppreference.com/w/cpp/memory/shared_ptr
 template <typename T>
 class SharedPtr {
@@ -107,6 +565,50 @@ public:
     template <typename Y>
     friend class WeakPtr;
 
+    template <typename Y>
+    friend class AtomicSharedPtr;
+
+    template <typename Y>
+    friend class CompactSharedPtr;
+
+    template <typename Y>
+    friend class EnableSharedFromThis;
+
+    template <typename Y>
+    friend class StaticImmortal;
+
+    // Factories that hand a new block over to the adopting constructor.
+    template <typename Y, typename... Args>
+    friend std::enable_if_t<!std::is_array_v<Y>, SharedPtr<Y>> MakeShared(Args&&... args);
+
+    template <typename Y>
+    friend std::enable_if_t<std::is_array_v<Y> && std::extent_v<Y> == 0, SharedPtr<Y>> MakeShared(
+        size_t size);
+
+    template <typename Y>
+    friend std::enable_if_t<std::is_array_v<Y> && std::extent_v<Y> != 0, SharedPtr<Y>>
+    MakeShared();
+
+    template <typename Y>
+    friend std::enable_if_t<std::is_array_v<Y> && std::extent_v<Y> == 0, SharedPtr<Y>>
+    MakeSharedForOverwrite(size_t size);
+
+    template <typename Y>
+    friend std::enable_if_t<std::is_array_v<Y> && std::extent_v<Y> != 0, SharedPtr<Y>>
+    MakeSharedForOverwrite();
+
+    template <typename Y, typename Alloc, typename... Args>
+    friend SharedPtr<Y> AllocateShared(const Alloc& alloc, Args&&... args);
+
+    template <typename Y, typename... Args>
+    friend SharedPtr<Y> MakeImmortal(Args&&... args);
+
+    template <typename Y, typename... Args>
+    friend SharedPtr<Y> MakeShardedShared(Args&&... args);
+
+    // `T` for single objects, `U` for `T = U[]` and `T = U[N]`.
+    using ElementType = std::remove_extent_t<T>;
+
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
 
@@ -114,17 +616,49 @@ public:
 
     SharedPtr(std::nullptr_t) : SharedPtr(){};
 
-    SharedPtr(ControlBlockOwning<T>* ptr) : observable_obj_(ptr->GetPointer()), cb_(ptr){};
+    SharedPtr(ControlBlockOwning<T>* ptr) : observable_obj_(ptr->GetPointer()), cb_(ptr) {
+        WireSharedFromThis(cb_, observable_obj_);
+    };
 
-    explicit SharedPtr(T* ptr) {
+    explicit SharedPtr(ElementType* ptr) {
         observable_obj_ = ptr;
-        cb_ = new ControlBlockPointer(ptr);
+        cb_ = new ControlBlockPointer<T>(ptr);
+        if constexpr (!std::is_array_v<T>) {
+            WireSharedFromThis(cb_, ptr);
+        }
     };
 
     template <typename U>
     explicit SharedPtr(U* ptr) {
         observable_obj_ = ptr;
-        cb_ = new ControlBlockPointer<U>(ptr);
+        cb_ = new ControlBlockPointer<std::conditional_t<std::is_array_v<T>, U[], U>>(ptr);
+        if constexpr (!std::is_array_v<T>) {
+            WireSharedFromThis(cb_, ptr);
+        }
+    }
+
+    // The control block is allocated through `alloc`, `deleter` releases `ptr`.
+    // If the allocation throws, `ptr` is released right away.
+    template <typename U, typename Deleter, typename Alloc>
+    SharedPtr(U* ptr, Deleter deleter, const Alloc& alloc) : observable_obj_(ptr) {
+        try {
+            cb_ = AllocateControlBlock<ControlBlockDeleter<U, Deleter, Alloc>>(alloc, ptr, deleter,
+                                                                              alloc);
+        } catch (...) {
+            deleter(ptr);
+            throw;
+        }
+        if constexpr (!std::is_array_v<T>) {
+            WireSharedFromThis(cb_, ptr);
+        }
+    }
+
+    // `deleter(ptr)` releases the object. The deleter is kept in the control block, an empty one
+    // takes no space.
+    template <typename U, typename Deleter,
+              typename = std::enable_if_t<std::is_invocable_v<Deleter&, U*>>>
+    SharedPtr(U* ptr, Deleter deleter)
+        : SharedPtr(ptr, std::move(deleter), std::allocator<std::remove_cv_t<U>>{}) {
     }
 
     SharedPtr(const SharedPtr& other) {
@@ -160,19 +694,26 @@ public:
     // Aliasing constructor
     // #8 from https://en.cppreference.com/w/cpp/memory/shared_ptr/shared_ptr
     template <typename Y>
-    SharedPtr(const SharedPtr<Y>& other, T* ptr) : observable_obj_(ptr), cb_(other.cb_) {
+    SharedPtr(const SharedPtr<Y>& other, ElementType* ptr)
+        : observable_obj_(ptr), cb_(other.cb_) {
         if (cb_) {
             cb_->IncStrongCounter();
         }
     }
 
+    // Aliasing constructor taking over the reference of `other`.
+    // #8 from https://en.cppreference.com/w/cpp/memory/shared_ptr/shared_ptr
+    template <typename Y>
+    SharedPtr(SharedPtr<Y>&& other, ElementType* ptr) noexcept
+        : observable_obj_(ptr), cb_(std::exchange(other.cb_, nullptr)) {
+        other.observable_obj_ = nullptr;
+    }
+
     // Promote `WeakPtr`
     // #11 from https://en.cppreference.com/w/cpp/memory/shared_ptr/shared_ptr
     explicit SharedPtr(const WeakPtr<T>& other)
         : observable_obj_(other.observable_obj_), cb_(other.cb_) {
-        if (!other.Expired()) {
-            cb_->IncStrongCounter();
-        } else {
+        if (!cb_ || !cb_->TryIncStrongCounter()) {
             throw BadWeakPtr{};
         }
     };
@@ -211,7 +752,7 @@ public:
         SharedPtr{}.Swap(*this);
     };
 
-    void Reset(T* ptr) {
+    void Reset(ElementType* ptr) {
         SharedPtr{ptr}.Swap(*this);
     };
 
@@ -220,6 +761,11 @@ public:
         SharedPtr{ptr}.Swap(*this);
     }
 
+    template <typename U, typename Deleter>
+    void Reset(U* ptr, Deleter deleter) {
+        SharedPtr{ptr, std::move(deleter)}.Swap(*this);
+    }
+
     void Swap(SharedPtr& other) {
         std::swap(observable_obj_, other.observable_obj_);
         std::swap(cb_, other.cb_);
@@ -228,19 +774,35 @@ public:
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Observers
 
-    T* Get() const {
+    ElementType* Get() const {
         return observable_obj_;
     };
 
-    T& operator*() const {
+    ElementType& operator*() const {
         assert(observable_obj_ != nullptr);
         return *observable_obj_;
     };
 
-    T* operator->() const {
+    ElementType* operator->() const {
         return observable_obj_;
     };
 
+    // Only for `SharedPtr<T[]>` and `SharedPtr<T[N]>`.
+    ElementType& operator[](std::ptrdiff_t index) const {
+        static_assert(std::is_array_v<T>, "operator[] requires an array type");
+        assert(observable_obj_ != nullptr);
+        return observable_obj_[index];
+    }
+
+    // The deleter passed to `SharedPtr(ptr, deleter)` if it has type `D`, `nullptr` otherwise.
+    template <typename D>
+    D* GetDeleter() const {
+        if (cb_) {
+            return static_cast<D*>(cb_->GetDeleter(&kTypeTag<std::remove_cv_t<D>>));
+        }
+        return nullptr;
+    }
+
     size_t UseCount() const {
         if (cb_) {
             return cb_->GetCounter();
@@ -255,28 +817,292 @@ public:
         return false;
     };
 
+    // Ownership-based comparisons: pointers sharing one control block are equivalent, wherever
+    // they point. See `OwnerLess`/`OwnerHash` in weak_cache.h.
+    template <typename U>
+    bool OwnerEqual(const SharedPtr<U>& other) const {
+        return cb_ == other.cb_;
+    }
+
+    template <typename U>
+    bool OwnerEqual(const WeakPtr<U>& other) const {
+        return cb_ == other.cb_;
+    }
+
+    template <typename U>
+    bool OwnerBefore(const SharedPtr<U>& other) const {
+        return std::less<const void*>{}(cb_, other.cb_);
+    }
+
+    template <typename U>
+    bool OwnerBefore(const WeakPtr<U>& other) const {
+        return std::less<const void*>{}(cb_, other.cb_);
+    }
+
+    size_t OwnerHash() const {
+        return std::hash<const void*>{}(cb_);
+    }
+
 private:
-    T* observable_obj_;
+    // Adopts the initial reference of a freshly created control block. Private: a block that is
+    // only borrowed would be released twice.
+    SharedPtr(ControlBlockBase* cb, ElementType* ptr) : observable_obj_(ptr), cb_(cb) {
+    }
+
+    ElementType* observable_obj_;
     ControlBlockBase* cb_;
 };
 
+template <typename T>
+struct IsTriviallyRelocatable<SharedPtr<T>> : std::true_type {};
+
 template <typename T, typename U>
 inline bool operator==(const SharedPtr<T>& left, const SharedPtr<U>& right);
 
-// Allocate memory only once
+// https://en.cppreference.com/w/cpp/memory/shared_ptr/pointer_cast
+// The rvalue overloads move the reference into the result instead of taking a new one.
+template <typename T, typename U>
+SharedPtr<T> StaticPointerCast(const SharedPtr<U>& ptr) {
+    return SharedPtr<T>{ptr, static_cast<typename SharedPtr<T>::ElementType*>(ptr.Get())};
+}
+
+template <typename T, typename U>
+SharedPtr<T> StaticPointerCast(SharedPtr<U>&& ptr) {
+    auto* cast = static_cast<typename SharedPtr<T>::ElementType*>(ptr.Get());
+    return SharedPtr<T>{std::move(ptr), cast};
+}
+
+// An empty result if the cast fails; `ptr` is left untouched then.
+template <typename T, typename U>
+SharedPtr<T> DynamicPointerCast(const SharedPtr<U>& ptr) {
+    if (auto* cast = dynamic_cast<typename SharedPtr<T>::ElementType*>(ptr.Get())) {
+        return SharedPtr<T>{ptr, cast};
+    }
+    return SharedPtr<T>{};
+}
+
+template <typename T, typename U>
+SharedPtr<T> DynamicPointerCast(SharedPtr<U>&& ptr) {
+    if (auto* cast = dynamic_cast<typename SharedPtr<T>::ElementType*>(ptr.Get())) {
+        return SharedPtr<T>{std::move(ptr), cast};
+    }
+    return SharedPtr<T>{};
+}
+
+#ifndef SW_SEPARATE_STORAGE_THRESHOLD
+#define SW_SEPARATE_STORAGE_THRESHOLD 4096
+#endif
+
+// Whether `MakeShared<T>` puts the object in its own allocation next to a small control block.
+// Then the object memory is freed as soon as the last `SharedPtr` is gone, instead of staying
+// inside the block until the last `WeakPtr` is gone too. On by default for objects larger than
+// `SW_SEPARATE_STORAGE_THRESHOLD` bytes; specialize it for other types that are weakly
+// referenced long after they die.
+template <typename T>
+struct UseSeparateStorage : std::bool_constant<(sizeof(T) > SW_SEPARATE_STORAGE_THRESHOLD)> {};
+
+// Makes the first `SharedPtr` to `object`, deleting it if that fails.
+template <typename T>
+SharedPtr<T> AdoptSeparate(T* object) {
+    try {
+        return SharedPtr<T>{object};
+    } catch (...) {
+        delete object;
+        throw;
+    }
+}
+
+// Allocate memory only once (twice for `UseSeparateStorage` types)
+template <typename T, typename... Args>
+std::enable_if_t<!std::is_array_v<T>, SharedPtr<T>> MakeShared(Args&&... args) {
+    if constexpr (UseSeparateStorage<T>::value) {
+        return AdoptSeparate(new T(std::forward<Args>(args)...));
+    } else {
+        // One block type for `T` and `const T`, so `CompactSharedPtr` recognizes both.
+        auto* tmp = new ControlBlockOwning<std::remove_cv_t<T>>(std::forward<Args>(args)...);
+        WireSharedFromThis(tmp, tmp->GetPointer());
+        return SharedPtr<T>{tmp, tmp->GetPointer()};
+    }
+};
+
+// `MakeShared<T[]>(n)`: `n` value-initialized elements placed right after the control block.
+template <typename T>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0, SharedPtr<T>> MakeShared(
+    size_t size) {
+    auto* block = ControlBlockArray<std::remove_extent_t<T>>::Create(size);
+    return SharedPtr<T>{block, block->GetPointer()};
+}
+
+// `MakeShared<T[N]>()`
+template <typename T>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> != 0, SharedPtr<T>> MakeShared() {
+    auto* block = ControlBlockArray<std::remove_extent_t<T>>::Create(std::extent_v<T>);
+    return SharedPtr<T>{block, block->GetPointer()};
+}
+
+// Like `MakeShared`, but the object is default-initialized: no zeroing of buffers that are going
+// to be overwritten anyway.
+template <typename T>
+std::enable_if_t<!std::is_array_v<T>, SharedPtr<T>> MakeSharedForOverwrite() {
+    if constexpr (UseSeparateStorage<T>::value) {
+        return AdoptSeparate(new T);
+    } else {
+        return SharedPtr<T>{new ControlBlockOwning<T>(ForOverwriteTag{})};
+    }
+}
+
+template <typename T>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> == 0, SharedPtr<T>>
+MakeSharedForOverwrite(size_t size) {
+    auto* block = ControlBlockArray<std::remove_extent_t<T>>::Create(size, ForOverwriteTag{});
+    return SharedPtr<T>{block, block->GetPointer()};
+}
+
+template <typename T>
+std::enable_if_t<std::is_array_v<T> && std::extent_v<T> != 0, SharedPtr<T>>
+MakeSharedForOverwrite() {
+    auto* block =
+        ControlBlockArray<std::remove_extent_t<T>>::Create(std::extent_v<T>, ForOverwriteTag{});
+    return SharedPtr<T>{block, block->GetPointer()};
+}
+
+// Same as `MakeShared`, but the memory comes from `alloc`.
+// Works with `std::pmr::polymorphic_allocator`, e.g. over a `std::pmr::monotonic_buffer_resource`.
+template <typename T, typename Alloc, typename... Args>
+SharedPtr<T> AllocateShared(const Alloc& alloc, Args&&... args) {
+    auto* block = AllocateControlBlock<ControlBlockOwningAlloc<T, Alloc>>(
+        alloc, alloc, std::forward<Args>(args)...);
+    WireSharedFromThis(block, block->GetPointer());
+    return SharedPtr<T>{block, block->GetPointer()};
+}
+
+// For singletons and sentinels shared everywhere: the object and its block are never freed, and
+// copying or destroying the returned pointers does not write to the counters. Allocates on every
+// call, see `StaticImmortal` for objects with static storage.
+template <typename T, typename... Args>
+SharedPtr<T> MakeImmortal(Args&&... args) {
+    auto* block = new ControlBlockImmortal<T>(std::forward<Args>(args)...);
+    WireSharedFromThis(block, block->GetPointer());
+    return SharedPtr<T>{block, block->GetPointer()};
+}
+
+// `MakeShared` for the few objects copied and released from every core at once (configuration
+// snapshots, shared dictionaries): the strong counter is spread over per-CPU cache lines, see
+// `ShardedCounter`. The block takes about 1 KiB, and `UseCount()` is approximate while other
+// threads change it.
 template <typename T, typename... Args>
-SharedPtr<T> MakeShared(Args&&... args) {
-    ControlBlockOwning<T>* tmp = new ControlBlockOwning<T>(std::forward<Args>(args)...);
-    return SharedPtr<T>{tmp};
+SharedPtr<T> MakeShardedShared(Args&&... args) {
+    auto* block = new ControlBlockSharded<std::remove_cv_t<T>>(std::forward<Args>(args)...);
+    WireSharedFromThis(block, block->GetPointer());
+    return SharedPtr<T>{block, block->GetPointer()};
+}
+
+// Immortal object and its block in storage provided by the caller, usually a static variable:
+//
+//     static StaticImmortal<Config> config(path);
+//     SharedPtr<Config> ptr = config.Share();
+//
+// Nothing is allocated, and `T` is not destroyed even when the holder is, so pointers shared
+// with other static objects stay valid during static destruction.
+template <typename T>
+class StaticImmortal {
+public:
+    template <typename... Args>
+    explicit StaticImmortal(Args&&... args) : block_(std::forward<Args>(args)...) {
+        WireSharedFromThis(&block_, block_.GetPointer());
+    }
+
+    StaticImmortal(const StaticImmortal&) = delete;
+    StaticImmortal& operator=(const StaticImmortal&) = delete;
+
+    SharedPtr<T> Share() {
+        return SharedPtr<T>{&block_, block_.GetPointer()};
+    }
+
+    T* Get() {
+        return block_.GetPointer();
+    }
+
+private:
+    ControlBlockImmortal<T> block_;
 };
 
 // Look for usage examples in tests
+//
+// The weak reference to the owning control block is set by whoever creates the first `SharedPtr`
+// to the object (`MakeShared`, `SharedPtr(T*)`, ...), so `SharedFromThis()` is a single counter
+// increment. Costs one pointer per object.
 template <typename T>
 class EnableSharedFromThis {
 public:
-    SharedPtr<T> SharedFromThis();
-    SharedPtr<const T> SharedFromThis() const;
+    SharedPtr<T> SharedFromThis() {
+        return SharedPtr<T>{AcquireBlock(), static_cast<T*>(this)};
+    }
+
+    SharedPtr<const T> SharedFromThis() const {
+        return SharedPtr<const T>{AcquireBlock(), static_cast<const T*>(this)};
+    }
+
+    WeakPtr<T> WeakFromThis() noexcept {
+        return MakeWeak<T>(static_cast<T*>(this));
+    }
+
+    WeakPtr<const T> WeakFromThis() const noexcept {
+        return MakeWeak<const T>(static_cast<const T*>(this));
+    }
+
+protected:
+    EnableSharedFromThis() noexcept : weak_cb_(nullptr) {
+    }
+
+    // A copy is a different object, owned by someone else (if by anyone).
+    EnableSharedFromThis(const EnableSharedFromThis&) noexcept : EnableSharedFromThis() {
+    }
+
+    EnableSharedFromThis& operator=(const EnableSharedFromThis&) noexcept {
+        return *this;
+    }
+
+    ~EnableSharedFromThis() {
+        if (weak_cb_) {
+            weak_cb_->DecWeakCounter();
+        }
+    }
+
+private:
+    template <typename Y>
+    friend void WireSharedFromThis(ControlBlockBase* cb, const EnableSharedFromThis<Y>* ptr);
+
+    // A caller of a member function keeps the object alive, so the object cannot be destroyed
+    // concurrently and no CAS loop is needed. Throws if the object is not owned by a `SharedPtr`
+    // yet (constructor) or any more (destructor).
+    ControlBlockBase* AcquireBlock() const {
+        if (!weak_cb_ || weak_cb_->Expired()) {
+            throw BadWeakPtr{};
+        }
+        weak_cb_->IncStrongCounter();
+        return weak_cb_;
+    }
 
-    WeakPtr<T> WeakFromThis() noexcept;
-    WeakPtr<const T> WeakFromThis() const noexcept;
+    template <typename U>
+    WeakPtr<U> MakeWeak(U* ptr) const noexcept {
+        WeakPtr<U> result;
+        if (weak_cb_) {
+            weak_cb_->IncWeakCounter();
+            result.observable_obj_ = ptr;
+            result.cb_ = weak_cb_;
+        }
+        return result;
+    }
+
+    mutable ControlBlockBase* weak_cb_;
 };
+
+template <typename Y>
+void WireSharedFromThis(ControlBlockBase* cb, const EnableSharedFromThis<Y>* ptr) {
+    // An object that already has an owner keeps it.
+    if (ptr && !ptr->weak_cb_) {
+        cb->IncWeakCounter();
+        ptr->weak_cb_ = cb;
+    }
+}
@@ -0,0 +1,228 @@
+#pragma once
+
+#include "shared.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>  // size_t, std::byte
+#include <utility>
+#include <vector>
+
+// `len` elements of a shared array, e.g. a payload inside a network buffer.
+//
+// The span owns a reference to the whole allocation through an aliasing `SharedPtr<T[]>` that
+// points at its first element. Slicing and splitting only move that pointer: no allocation and no
+// copying of elements, a slice costs one counter increment (none when slicing an rvalue).
+template <typename T>
+class SharedSpan {
+public:
+    template <typename U>
+    friend class SharedSpan;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Constructors
+
+    SharedSpan() : size_(0) {
+    }
+
+    // `size` elements starting at `data.Get()`.
+    SharedSpan(SharedPtr<T[]> data, size_t size) : data_(std::move(data)), size_(size) {
+    }
+
+    // `SharedSpan<T>` to `SharedSpan<const T>`
+    template <typename U>
+    SharedSpan(const SharedSpan<U>& other)
+        : data_(other.data_, other.data_.Get()), size_(other.size_) {
+    }
+
+    template <typename U>
+    SharedSpan(SharedSpan<U>&& other)
+        : data_(std::move(other.data_)), size_(std::exchange(other.size_, 0)) {
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Slicing
+
+    // `len` elements starting at `offset`.
+    SharedSpan Slice(size_t offset, size_t len) const& {
+        assert(offset <= size_ && len <= size_ - offset);
+        return SharedSpan{SharedPtr<T[]>{data_, data_.Get() + offset}, len};
+    }
+
+    SharedSpan Slice(size_t offset, size_t len) && {
+        assert(offset <= size_ && len <= size_ - offset);
+        T* data = data_.Get() + offset;
+        size_ = 0;
+        return SharedSpan{SharedPtr<T[]>{std::move(data_), data}, len};
+    }
+
+    // Elements from `offset` to the end.
+    SharedSpan Slice(size_t offset) const& {
+        return Slice(offset, size_ - offset);
+    }
+
+    SharedSpan Slice(size_t offset) && {
+        return std::move(*this).Slice(offset, size_ - offset);
+    }
+
+    // `[0, offset)` and `[offset, Size())`.
+    std::pair<SharedSpan, SharedSpan> Split(size_t offset) const& {
+        return {Slice(0, offset), Slice(offset)};
+    }
+
+    std::pair<SharedSpan, SharedSpan> Split(size_t offset) && {
+        SharedSpan front = Slice(0, offset);
+        return {std::move(front), std::move(*this).Slice(offset)};
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    T* Data() const {
+        return data_.Get();
+    }
+
+    size_t Size() const {
+        return size_;
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    T& operator[](size_t index) const {
+        assert(index < size_);
+        return data_.Get()[index];
+    }
+
+    T* begin() const {
+        return data_.Get();
+    }
+
+    T* end() const {
+        return data_.Get() + size_;
+    }
+
+    // Whether `next` continues this span in the same allocation.
+    template <typename U>
+    bool IsFollowedBy(const SharedSpan<U>& next) const {
+        return data_.OwnerEqual(next.data_) && end() == next.begin();
+    }
+
+private:
+    // Takes in the `size` elements that follow the span in the same allocation.
+    void Extend(size_t size) {
+        size_ += size;
+    }
+
+    template <typename U>
+    friend class SharedSpanChain;
+
+    SharedPtr<T[]> data_;
+    size_t size_;
+};
+
+using SharedBuffer = SharedSpan<std::byte>;
+
+// Span over a new array of `size` value-initialized elements.
+template <typename T>
+SharedSpan<T> MakeSharedSpan(size_t size) {
+    return SharedSpan<T>{MakeShared<T[]>(size), size};
+}
+
+// Same, but the elements are default-initialized: a buffer that is about to be filled from a
+// socket is not zeroed first.
+template <typename T>
+SharedSpan<T> MakeSharedSpanForOverwrite(size_t size) {
+    return SharedSpan<T>{MakeSharedForOverwrite<T[]>(size), size};
+}
+
+// Sequence of spans for scatter/gather I/O. Each segment keeps its own allocation alive;
+// appending a span that continues the last segment in the same allocation extends that segment,
+// so a message reassembled from adjacent slices stays one segment with one control block.
+template <typename T>
+class SharedSpanChain {
+public:
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    void Append(SharedSpan<T> span) {
+        if (span.Empty()) {
+            return;
+        }
+        size_ += span.Size();
+        if (!segments_.empty() && segments_.back().IsFollowedBy(span)) {
+            segments_.back().Extend(span.Size());
+            return;
+        }
+        segments_.push_back(std::move(span));
+    }
+
+    void Append(const SharedSpanChain& other) {
+        if (&other == this) {
+            // Appending would reallocate and extend the segments being read.
+            SharedSpanChain copy = other;
+            Append(copy);
+            return;
+        }
+        segments_.reserve(segments_.size() + other.segments_.size());
+        for (const SharedSpan<T>& span : other.segments_) {
+            Append(span);
+        }
+    }
+
+    void Clear() {
+        segments_.clear();
+        size_ = 0;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Slicing
+
+    // `len` elements starting at `offset`, counted over all segments.
+    SharedSpanChain Slice(size_t offset, size_t len) const {
+        assert(offset <= size_ && len <= size_ - offset);
+        SharedSpanChain result;
+        for (const SharedSpan<T>& span : segments_) {
+            if (len == 0) {
+                break;
+            }
+            if (offset >= span.Size()) {
+                offset -= span.Size();
+                continue;
+            }
+            size_t take = std::min(len, span.Size() - offset);
+            result.Append(span.Slice(offset, take));
+            offset = 0;
+            len -= take;
+        }
+        return result;
+    }
+
+    // `[0, offset)` and `[offset, Size())`.
+    std::pair<SharedSpanChain, SharedSpanChain> Split(size_t offset) const {
+        return {Slice(0, offset), Slice(offset, size_ - offset)};
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // Total number of elements.
+    size_t Size() const {
+        return size_;
+    }
+
+    bool Empty() const {
+        return size_ == 0;
+    }
+
+    const std::vector<SharedSpan<T>>& Segments() const {
+        return segments_;
+    }
+
+private:
+    std::vector<SharedSpan<T>> segments_;
+    size_t size_ = 0;
+};
+
+using SharedBufferChain = SharedSpanChain<std::byte>;
@@ -17,3 +17,12 @@ class SharedPtr;
 
 template <typename T>
 class WeakPtr;
+
+template <typename T>
+class AtomicSharedPtr;
+
+template <typename T>
+class CompactSharedPtr;
+
+template <typename T>
+class EnableSharedFromThis;
@@ -13,6 +13,13 @@ public:
 
     template <typename U>
     friend class WeakPtr;
+
+    template <typename U>
+    friend class CompactSharedPtr;
+
+    template <typename U>
+    friend class EnableSharedFromThis;
+
     ////////////////////////////////////////////////////////////////////////////////////////////////
     // Constructors
 
@@ -95,13 +102,43 @@ public:
     };
 
     SharedPtr<T> Lock() const {
-        if (!cb_ || Expired()) {
-            return SharedPtr<T>{};
+        SharedPtr<T> result;
+        if (cb_ && cb_->TryIncStrongCounter()) {
+            result.observable_obj_ = observable_obj_;
+            result.cb_ = cb_;
         }
-        return SharedPtr<T>(*this);
+        return result;
     };
 
+    // Same as the `SharedPtr` ones: stay valid after the object expires.
+    template <typename U>
+    bool OwnerEqual(const SharedPtr<U>& other) const {
+        return cb_ == other.cb_;
+    }
+
+    template <typename U>
+    bool OwnerEqual(const WeakPtr<U>& other) const {
+        return cb_ == other.cb_;
+    }
+
+    template <typename U>
+    bool OwnerBefore(const SharedPtr<U>& other) const {
+        return std::less<const void*>{}(cb_, other.cb_);
+    }
+
+    template <typename U>
+    bool OwnerBefore(const WeakPtr<U>& other) const {
+        return std::less<const void*>{}(cb_, other.cb_);
+    }
+
+    size_t OwnerHash() const {
+        return std::hash<const void*>{}(cb_);
+    }
+
 private:
-    T* observable_obj_;
+    std::remove_extent_t<T>* observable_obj_;
     ControlBlockBase* cb_;
 };
+
+template <typename T>
+struct IsTriviallyRelocatable<WeakPtr<T>> : std::true_type {};
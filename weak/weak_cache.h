@@ -0,0 +1,202 @@
+#pragma once
+
+#include "sharded_map.h"
+#include "weak.h"
+
+#include <atomic>
+#include <cstddef>  // size_t
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+
+// Ownership-based comparison of `SharedPtr`s and `WeakPtr`s (in any combination): pointers that
+// share one control block are equivalent, even aliased or expired ones. For keying maps and sets
+// by object identity without keeping the objects alive.
+struct OwnerLess {
+    template <typename P, typename Q>
+    bool operator()(const P& left, const Q& right) const {
+        return left.OwnerBefore(right);
+    }
+};
+
+struct OwnerEqual {
+    template <typename P, typename Q>
+    bool operator()(const P& left, const Q& right) const {
+        return left.OwnerEqual(right);
+    }
+};
+
+struct OwnerHash {
+    template <typename P>
+    size_t operator()(const P& ptr) const {
+        return ptr.OwnerHash();
+    }
+};
+
+struct CacheStats {
+    size_t hits = 0;     // lookups that returned a live value
+    size_t misses = 0;   // lookups that found no live value
+    size_t expired = 0;  // dead entries dropped by a lookup
+    size_t evicted = 0;  // entries removed when their value died
+};
+
+// Map from keys to values that the cache does not keep alive.
+//
+// Values created by `GetOrCreate` carry a deleter that removes their entry as soon as the last
+// `SharedPtr` is gone, so the map doesn't fill up with dead entries and no periodic scan is
+// needed. Values added with `Insert` are dropped lazily, by the first lookup that finds them
+// expired. Lookups never throw `BadWeakPtr`.
+//
+// Keys are spread over the independently locked shards of a `ShardedMap`. Requires thread-safe
+// counters (`SW_ATOMIC_COUNTERS`): the locks only cover the maps, while the values handed out are
+// copied and released on any thread.
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename KeyEqual = std::equal_to<K>>
+class WeakValueCache {
+public:
+    WeakValueCache() : core_(MakeShared<Core>()) {
+    }
+
+    WeakValueCache(const WeakValueCache&) = delete;
+    WeakValueCache& operator=(const WeakValueCache&) = delete;
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Lookup
+
+    // The value for `key` if it is still alive, an empty pointer otherwise.
+    SharedPtr<V> TryLock(const K& key) {
+        Shard& shard = core_->ShardFor(key);
+        SharedPtr<V> result;
+        {
+            std::lock_guard guard{shard.mutex};
+            auto it = shard.entries.find(key);
+            if (it != shard.entries.end()) {
+                result = it->second.value.Lock();
+                if (!result) {
+                    shard.entries.erase(it);
+                    Bump(core_->expired);
+                }
+            }
+        }
+        Bump(result ? core_->hits : core_->misses);
+        return result;
+    }
+
+    // The value for `key`, created from `args` if there is no live one. The value is constructed
+    // outside of the lock; if another thread stores a value for `key` meanwhile, that one wins.
+    template <typename... Args>
+    SharedPtr<V> GetOrCreate(const K& key, Args&&... args) {
+        if (SharedPtr<V> found = TryLock(key)) {
+            return found;
+        }
+        SharedPtr<V> created(new V(std::forward<Args>(args)...), Evict{WeakPtr<Core>{core_}, key});
+        SharedPtr<V> result;
+        {
+            Shard& shard = core_->ShardFor(key);
+            std::lock_guard guard{shard.mutex};
+            Entry& entry = shard.entries[key];
+            result = entry.value.Lock();
+            if (!result) {
+                entry = Entry{created};
+                result = created;
+            }
+        }
+        // A value that lost the race is released here, out of the lock its deleter takes.
+        return result;
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Modifiers
+
+    // Replaces the entry for `key`. The entry expires together with `value`.
+    void Insert(const K& key, const SharedPtr<V>& value) {
+        Shard& shard = core_->ShardFor(key);
+        std::lock_guard guard{shard.mutex};
+        shard.entries[key] = Entry{value};
+    }
+
+    void Erase(const K& key) {
+        Shard& shard = core_->ShardFor(key);
+        std::lock_guard guard{shard.mutex};
+        shard.entries.erase(key);
+    }
+
+    ////////////////////////////////////////////////////////////////////////////////////////////////
+    // Observers
+
+    // Number of entries, including expired ones that were not dropped yet.
+    size_t Size() const {
+        return core_->Size();
+    }
+
+    CacheStats GetStats() const {
+        CacheStats stats;
+        stats.hits = core_->hits.load(std::memory_order_relaxed);
+        stats.misses = core_->misses.load(std::memory_order_relaxed);
+        stats.expired = core_->expired.load(std::memory_order_relaxed);
+        stats.evicted = core_->evicted.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    struct Entry {
+        Entry() = default;
+
+        explicit Entry(const SharedPtr<V>& ptr) : value(ptr), object(ptr.Get()) {
+        }
+
+        WeakPtr<V> value;
+        // Tells the entry of a dying value from a newer one stored under the same key.
+        const V* object = nullptr;
+    };
+
+    using Map = ShardedMap<std::unordered_map<K, Entry, Hash, KeyEqual>>;
+    using Shard = typename Map::Shard;
+
+    // Shared with the deleters of the values, which may outlive the cache.
+    struct Core : Map {
+        Shard& ShardFor(const K& key) {
+            return Map::ShardFor(Hash{}(key));
+        }
+
+        // Called while `object` is being destroyed.
+        void Evict(const K& key, const V* object) {
+            Shard& shard = ShardFor(key);
+            std::lock_guard guard{shard.mutex};
+            auto it = shard.entries.find(key);
+            if (it != shard.entries.end() && it->second.object == object) {
+                shard.entries.erase(it);
+                Bump(evicted);
+            }
+        }
+
+        std::atomic<size_t> hits = 0;
+        std::atomic<size_t> misses = 0;
+        std::atomic<size_t> expired = 0;
+        std::atomic<size_t> evicted = 0;
+    };
+
+    static_assert(kThreadSafeRefCounts<K>,
+                  "WeakValueCache requires thread-safe counters (SW_ATOMIC_COUNTERS)");
+
+    // Runs when the last strong reference to a value created by `GetOrCreate` is gone.
+    struct Evict {
+        WeakPtr<Core> core;
+        K key;
+
+        void operator()(V* object) {
+            // The entry goes first: once the object is freed, its address may be reused.
+            if (SharedPtr<Core> locked = core.Lock()) {
+                locked->Evict(key, object);
+            }
+            delete object;
+        }
+    };
+
+    static void Bump(std::atomic<size_t>& counter) {
+        counter.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    SharedPtr<Core> core_;
+};